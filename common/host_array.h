@@ -0,0 +1,60 @@
+#pragma once
+
+// host arrays which OpenCL buffers can work in without copying: on CPU and integrated GPU devices a buffer
+// created with CL_MEM_USE_HOST_PTR over page-aligned memory of whole pages uses that memory itself,
+// so writing and reading the buffer is replaced by mapping it
+
+#include <cstdlib>
+#include <cstring>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+#ifndef CL_TARGET_OPENCL_VERSION
+#define CL_TARGET_OPENCL_VERSION 120
+#endif
+#ifdef __APPLE__
+#include <OpenCL/cl.h>
+#else
+#include <CL/cl.h>
+#endif
+
+// alignment and size step of the arrays, a page satisfies the drivers which ask for less
+#define HOST_ARRAY_ALIGNMENT 4096
+
+// the device shares memory with the host
+inline bool ZeroCopyDevice(cl_device_id device_id) {
+	cl_device_type device_type;
+	clGetDeviceInfo(device_id, CL_DEVICE_TYPE, sizeof(device_type), &device_type, NULL);
+	if (device_type == CL_DEVICE_TYPE_CPU) {
+		return true;
+	}
+	cl_bool is_integrated;
+	clGetDeviceInfo(device_id, CL_DEVICE_HOST_UNIFIED_MEMORY, sizeof(cl_bool), &is_integrated, NULL);
+	return is_integrated;
+}
+
+// zero-filled page-aligned array of count floats, nullptr if it can not be allocated
+inline float* AllocHostArray(size_t count) {
+	size_t bytes = (sizeof(float) * count + HOST_ARRAY_ALIGNMENT - 1) / HOST_ARRAY_ALIGNMENT * HOST_ARRAY_ALIGNMENT;
+	if (bytes == 0) {
+		bytes = HOST_ARRAY_ALIGNMENT;
+	}
+#ifdef _WIN32
+	float* array = (float*)_aligned_malloc(bytes, HOST_ARRAY_ALIGNMENT);
+#else
+	float* array = (float*)aligned_alloc(HOST_ARRAY_ALIGNMENT, bytes);
+#endif
+	if (array != nullptr) {
+		memset(array, 0, bytes);
+	}
+	return array;
+}
+
+inline void FreeHostArray(float* array) {
+#ifdef _WIN32
+	_aligned_free(array);
+#else
+	free(array);
+#endif
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+// cache of built OpenCL programs on disk: the binary of a program is saved after it is built from source
+// and is loaded instead of building it the next time. A binary is found by the hash of the kernel source,
+// the build options, the device name and the driver version, so a change of any of them builds the program again
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifndef CL_TARGET_OPENCL_VERSION
+#define CL_TARGET_OPENCL_VERSION 120
+#endif
+#ifdef __APPLE__
+#include <OpenCL/cl.h>
+#else
+#include <CL/cl.h>
+#endif
+
+// directory of the cached binaries, relative to the working directory
+#define PROGRAM_CACHE_DIR "program_cache"
+
+// device name and driver version separated by a tab
+inline std::string DeviceKey(cl_device_id device_id) {
+
+	size_t size;
+	clGetDeviceInfo(device_id, CL_DEVICE_NAME, 0, NULL, &size);
+	std::string name(size, '\0');
+	clGetDeviceInfo(device_id, CL_DEVICE_NAME, size, &name[0], NULL);
+	clGetDeviceInfo(device_id, CL_DRIVER_VERSION, 0, NULL, &size);
+	std::string driver(size, '\0');
+	clGetDeviceInfo(device_id, CL_DRIVER_VERSION, size, &driver[0], NULL);
+
+	// without the terminating zeros, tabs separate the fields
+	name.resize(strlen(name.c_str()));
+	driver.resize(strlen(driver.c_str()));
+	std::replace(name.begin(), name.end(), '\t', ' ');
+	std::replace(driver.begin(), driver.end(), '\t', ' ');
+	return name + "\t" + driver;
+
+}
+
+// FNV-1a, the parts are separated by zeros so that moving a character from one part to another changes the hash
+inline uint64_t ProgramHash(const std::vector<std::string>& parts) {
+	uint64_t hash = 14695981039346656037ull;
+	for (const std::string& part : parts) {
+		for (size_t i = 0; i <= part.size(); i++) {
+			hash ^= (unsigned char)part.c_str()[i];
+			hash *= 1099511628211ull;
+		}
+	}
+	return hash;
+}
+
+inline std::string ProgramCachePath(cl_device_id device_id, const std::string& source, const std::string& options) {
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)ProgramHash({ source, options, DeviceKey(device_id) }));
+	return std::string(PROGRAM_CACHE_DIR) + "/" + name;
+}
+
+// program from the cached binary, NULL if there is no binary or the device does not accept it
+inline cl_program LoadProgramBinary(cl_context context, cl_device_id device_id, const std::string& path, const std::string& options) {
+
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		return NULL;
+	}
+	std::vector<unsigned char> binary((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	file.close();
+	if (binary.empty()) {
+		return NULL;
+	}
+
+	size_t size = binary.size();
+	const unsigned char* data = binary.data();
+	cl_int binary_status, ret;
+	cl_program program = clCreateProgramWithBinary(context, 1, &device_id, &size, &data, &binary_status, &ret);
+	if (ret != CL_SUCCESS or binary_status != CL_SUCCESS) {
+		if (program != NULL) {
+			clReleaseProgram(program);
+		}
+		return NULL;
+	}
+	// a program created from a binary still has to be built, it is fast
+	ret = clBuildProgram(program, 1, &device_id, options.c_str(), NULL, NULL);
+	if (ret != CL_SUCCESS) {
+		clReleaseProgram(program);
+		return NULL;
+	}
+	return program;
+
+}
+
+// writing to a temporary file first, so that a run started at the same time does not read half of the binary
+inline void SaveProgramBinary(cl_program program, const std::string& path) {
+
+	size_t size = 0;
+	if (clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES, sizeof(size_t), &size, NULL) != CL_SUCCESS or size == 0) {
+		return;
+	}
+	std::vector<unsigned char> binary(size);
+	unsigned char* data = binary.data();
+	if (clGetProgramInfo(program, CL_PROGRAM_BINARIES, sizeof(unsigned char*), &data, NULL) != CL_SUCCESS) {
+		return;
+	}
+
+	std::error_code error;
+	std::filesystem::create_directories(PROGRAM_CACHE_DIR, error);
+	std::string temporary_path = path + "." + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+	std::ofstream file(temporary_path, std::ios::binary);
+	if (!file) {
+		return;
+	}
+	file.write((const char*)binary.data(), binary.size());
+	file.close();
+	if (!file) {
+		std::filesystem::remove(temporary_path, error);
+		return;
+	}
+	std::filesystem::rename(temporary_path, path, error);
+	if (error) {
+		std::filesystem::remove(temporary_path, error);
+	}
+
+}
+
+// program for the device built with the options, from the cached binary if there is a valid one, otherwise from source.
+// Returns NULL if the program can not be created, ret is the error of the building from source
+inline cl_program BuildProgramCached(cl_context context, cl_device_id device_id, const std::string& source, const std::string& options,
+	cl_int* ret, bool* from_cache) {
+
+	std::string path = ProgramCachePath(device_id, source, options);
+	cl_program program = LoadProgramBinary(context, device_id, path, options);
+	*from_cache = program != NULL;
+	if (program != NULL) {
+		*ret = CL_SUCCESS;
+		return program;
+	}
+
+	const char* code = source.c_str();
+	program = clCreateProgramWithSource(context, 1, &code, NULL, ret);
+	if (*ret != CL_SUCCESS) {
+		return NULL;
+	}
+	*ret = clBuildProgram(program, 1, &device_id, options.c_str(), NULL, NULL);
+	if (*ret == CL_SUCCESS) {
+		SaveProgramBinary(program, path);
+	}
+	return program;
+
+}
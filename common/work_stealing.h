@@ -0,0 +1,366 @@
+#pragma once
+
+//work-stealing thread pool which does not depend on the OpenMP runtime: the team of workers is started once,
+//every worker has its own Chase-Lev deque, it pushes and takes tasks at the bottom and steals from the top
+//of the others when its deque is empty. A job is run on the calling thread as worker 0, its tasks are spawned
+//into task groups, a worker waiting for a group executes other tasks meanwhile
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+//initial capacity of a deque, it doubles when the deque is full
+#define DEQUE_CAPACITY 256
+
+namespace work_stealing {
+
+class Task {
+
+public:
+
+    virtual ~Task() = default;
+    virtual void run() = 0;
+
+    //tasks of the group which are not finished yet
+    std::atomic<int>* pending = nullptr;
+
+};
+
+template <class F>
+class FunctionTask : public Task {
+
+public:
+
+    explicit FunctionTask(F f) : f(std::move(f)) {}
+
+    void run() override {
+        f();
+    }
+
+private:
+
+    F f;
+
+};
+
+//Chase-Lev deque with the memory orders of Le, Pop, Cohen and Zappa Nardelli:
+//only the owner pushes and takes at the bottom, any worker steals at the top
+class Deque {
+
+public:
+
+    Deque() : top(0), bottom(0) {
+        arrays.emplace_back(new Array(DEQUE_CAPACITY));
+        array.store(arrays.back().get(), std::memory_order_relaxed);
+    }
+
+    void push(Task* task) {
+
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        Array* a = array.load(std::memory_order_relaxed);
+        if (b - t > a->capacity - 1) {
+            a = grow(a, t, b);
+        }
+        a->put(b, task);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+
+    }
+
+    //the last pushed task or nullptr
+    Task* take() {
+
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        Array* a = array.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+
+        Task* task = nullptr;
+        if (t <= b) {
+            task = a->get(b);
+            if (t == b) {
+                //the last task, a thief may want it too
+                if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                    task = nullptr;
+                }
+                bottom.store(b + 1, std::memory_order_relaxed);
+            }
+        }
+        else {
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return task;
+
+    }
+
+    //the first pushed task or nullptr if there is none or another thief was faster
+    Task* steal() {
+
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+
+        if (t < b) {
+            Array* a = array.load(std::memory_order_acquire);
+            Task* task = a->get(t);
+            if (top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                return task;
+            }
+        }
+        return nullptr;
+
+    }
+
+private:
+
+    struct Array {
+
+        explicit Array(int64_t capacity) : capacity(capacity), items(new std::atomic<Task*>[capacity]) {}
+
+        Task* get(int64_t i) const {
+            return items[i & (capacity - 1)].load(std::memory_order_relaxed);
+        }
+
+        void put(int64_t i, Task* task) {
+            items[i & (capacity - 1)].store(task, std::memory_order_relaxed);
+        }
+
+        int64_t capacity;
+        std::unique_ptr<std::atomic<Task*>[]> items;
+
+    };
+
+    Array* grow(Array* a, int64_t t, int64_t b) {
+
+        Array* bigger = new Array(a->capacity * 2);
+        for (int64_t i = t; i < b; i++) {
+            bigger->put(i, a->get(i));
+        }
+        //the old arrays are freed with the deque, a thief may still read them
+        arrays.emplace_back(bigger);
+        array.store(bigger, std::memory_order_release);
+        return bigger;
+
+    }
+
+    alignas(64) std::atomic<int64_t> top;
+    alignas(64) std::atomic<int64_t> bottom;
+    std::atomic<Array*> array;
+    std::vector<std::unique_ptr<Array>> arrays;
+
+};
+
+class Pool {
+
+public:
+
+    explicit Pool(int thNum) : deques(thNum) {
+
+        for (int i = 1; i < thNum; i++) {
+            workers.emplace_back(&Pool::work, this, i);
+        }
+
+    }
+
+    ~Pool() {
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+
+    }
+
+    Pool(const Pool&) = delete;
+    Pool& operator=(const Pool&) = delete;
+
+    int size() const {
+        return (int)deques.size();
+    }
+
+    //the team started once and reused by all the jobs of thNum threads
+    static Pool& shared(int thNum) {
+
+        static std::mutex sharedMutex;
+        static std::unique_ptr<Pool> pool;
+        std::lock_guard<std::mutex> lock(sharedMutex);
+        if (!pool or pool->size() != thNum) {
+            pool.reset(new Pool(thNum));
+        }
+        return *pool;
+
+    }
+
+    //runs job on the calling thread as worker 0 while the other workers steal its tasks,
+    //a job started from a task of the same pool is just called
+    template <class F>
+    void run(F job) {
+
+        if (current().pool == this) {
+            job();
+            return;
+        }
+
+        std::lock_guard<std::mutex> jobLock(jobMutex);
+        Worker saved = current();
+        current() = Worker{ this, 0 };
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobRunning.store(true, std::memory_order_release);
+        }
+        wake.notify_all();
+
+        job();
+
+        jobRunning.store(false, std::memory_order_release);
+        current() = saved;
+
+    }
+
+    //pushes task to the deque of the calling worker
+    void push(Task* task) {
+        deques[current().idx].push(task);
+    }
+
+    //a task of the calling worker's deque or a stolen one, nullptr if nothing was found
+    Task* find_task() {
+
+        int idx = current().idx;
+        Task* task = deques[idx].take();
+        int thNum = size();
+        for (int attempt = 0; task == nullptr and attempt < 2 * thNum; attempt++) {
+            int victim = (int)(next_random() % (unsigned)thNum);
+            if (victim != idx) {
+                task = deques[victim].steal();
+            }
+        }
+        return task;
+
+    }
+
+    static void execute(Task* task) {
+
+        task->run();
+        std::atomic<int>* pending = task->pending;
+        delete task;
+        pending->fetch_sub(1, std::memory_order_release);
+
+    }
+
+private:
+
+    struct Worker {
+        Pool* pool;
+        int idx;
+    };
+
+    std::vector<Deque> deques;
+    std::vector<std::thread> workers;
+    std::mutex jobMutex;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::atomic<bool> jobRunning{ false };
+    bool stopping = false;
+
+    static Worker& current() {
+        static thread_local Worker worker{ nullptr, 0 };
+        return worker;
+    }
+
+    //xorshift for the choice of victims
+    static unsigned next_random() {
+        static thread_local unsigned state = 2463534242u;
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    //workers sleep between jobs and look for tasks while a job is running
+    void work(int idx) {
+
+        current() = Worker{ this, idx };
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this]() {
+                    return stopping or jobRunning.load(std::memory_order_acquire);
+                });
+                if (stopping) {
+                    return;
+                }
+            }
+            while (jobRunning.load(std::memory_order_acquire)) {
+                Task* task = find_task();
+                if (task != nullptr) {
+                    execute(task);
+                }
+                else {
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+    }
+
+};
+
+//tasks spawned by one worker which it waits for together
+class TaskGroup {
+
+public:
+
+    explicit TaskGroup(Pool& pool) : pool(pool) {}
+
+    ~TaskGroup() {
+        wait();
+    }
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    //f is pushed to the bottom of the deque and the spawning worker goes on, an idle worker may steal f
+    template <class F>
+    void spawn(F f) {
+
+        Task* task = new FunctionTask<F>(std::move(f));
+        task->pending = &pending;
+        pending.fetch_add(1, std::memory_order_relaxed);
+        pool.push(task);
+
+    }
+
+    //executes tasks of any group until all the tasks of this one are finished
+    void wait() {
+
+        while (pending.load(std::memory_order_acquire) > 0) {
+            Task* task = pool.find_task();
+            if (task != nullptr) {
+                Pool::execute(task);
+            }
+            else {
+                std::this_thread::yield();
+            }
+        }
+
+    }
+
+private:
+
+    Pool& pool;
+    std::atomic<int> pending{ 0 };
+
+};
+
+}
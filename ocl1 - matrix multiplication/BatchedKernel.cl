@@ -0,0 +1,42 @@
+// batch of small matrices stored one after another (strided-batched layout), a work-group multiplies MPG pairs of them,
+// one pair for each index along dimension 2, and its TSxTS work-items go over C of the pair tile by tile
+__kernel void Multiplication(const int N, const int K, const int M, const __global float* A, const __global float* B, __global float* C, const int batch_count)
+{
+	// getting work-item IDs with dimension index
+	const int col = get_local_id(0);
+	const int row = get_local_id(1);
+	const int pair = get_local_id(2);
+	const int matrix = get_group_id(2) * MPG + pair;
+
+	// the last group may have pairs after the end of the batch, they only take part in the barriers
+	const bool active = matrix < batch_count;
+	const __global float* A_matrix = A + (size_t)min(matrix, batch_count - 1) * M * K;
+	const __global float* B_matrix = B + (size_t)min(matrix, batch_count - 1) * K * N;
+	__global float* C_matrix = C + (size_t)min(matrix, batch_count - 1) * M * N;
+
+	__local float Asub[MPG][TS][TS];
+	__local float Bsub[MPG][TS][TS];
+
+	for (int tile_row = 0; tile_row < M; tile_row += TS) {
+		for (int tile_col = 0; tile_col < N; tile_col += TS) {
+			float result_element = 0.0f;
+
+			for (int t = 0; t < K; t += TS) {
+				Asub[pair][row][col] = (active && tile_row + row < M && t + col < K) ? A_matrix[(tile_row + row) * K + t + col] : 0.0f;
+				Bsub[pair][row][col] = (active && t + row < K && tile_col + col < N) ? B_matrix[(t + row) * N + tile_col + col] : 0.0f;
+
+				barrier(CLK_LOCAL_MEM_FENCE);
+
+				for (int k = 0; k < TS; k++) {
+					result_element += Asub[pair][row][k] * Bsub[pair][k][col];
+				}
+
+				barrier(CLK_LOCAL_MEM_FENCE);
+			}
+
+			if (active && tile_row + row < M && tile_col + col < N) {
+				C_matrix[(tile_row + row) * N + tile_col + col] = result_element;
+			}
+		}
+	}
+}
\ No newline at end of file
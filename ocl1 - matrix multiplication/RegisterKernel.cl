@@ -0,0 +1,68 @@
+// work-group computes a TSxTS tile of C, each of its (TS/WPT)x(TS/WPT) work-items keeps a WPTxWPT block of it in registers
+// dimension 0 goes along the columns of C, so neighbouring work-items read and write neighbouring elements,
+// the tiles on the edges of the matrices are filled with zeros outside of them
+#define RTS (TS / WPT)
+
+__kernel void Multiplication(const int N, const int K, const int M, const __global float* A, const __global float* B, __global float* C)
+{
+	// getting work-item IDs with dimension index
+	const int col = get_local_id(0);
+	const int row = get_local_id(1);
+	const int tile_col = TS * get_group_id(0);
+	const int tile_row = TS * get_group_id(1);
+	const int local_id = row * RTS + col;
+
+	// tiles of A (stored transposed) and B for TSK steps along K,
+	// A tile rows are padded so that the transposing stores do not hit the same bank
+	__local float Asub[TSK][TS + 2];
+	__local float Bsub[TSK][TS];
+
+	// elements of C computed by this work-item are RTS apart in both dimensions
+	float acc[WPT][WPT];
+	for (int wm = 0; wm < WPT; wm++) {
+		for (int wn = 0; wn < WPT; wn++) {
+			acc[wm][wn] = 0.0f;
+		}
+	}
+	float Breg[WPT];
+
+	const int num_tiles = (K + TSK - 1) / TSK;
+	for (int t = 0; t < num_tiles; t++) {
+		// all the work-items of the group load both tiles together
+		for (int e = local_id; e < TS * TSK; e += RTS * RTS) {
+			const int a_row = tile_row + e / TSK;
+			const int a_col = TSK * t + e % TSK;
+			Asub[e % TSK][e / TSK] = (a_row < M && a_col < K) ? A[a_row * K + a_col] : 0.0f;
+			const int b_row = TSK * t + e / TS;
+			const int b_col = tile_col + e % TS;
+			Bsub[e / TS][e % TS] = (b_row < K && b_col < N) ? B[b_row * N + b_col] : 0.0f;
+		}
+
+		barrier(CLK_LOCAL_MEM_FENCE);
+
+		// 2 * WPT loads from local memory for WPT * WPT multiply-adds
+		for (int k = 0; k < TSK; k++) {
+			for (int wn = 0; wn < WPT; wn++) {
+				Breg[wn] = Bsub[k][col + wn * RTS];
+			}
+			for (int wm = 0; wm < WPT; wm++) {
+				const float Areg = Asub[k][row + wm * RTS];
+				for (int wn = 0; wn < WPT; wn++) {
+					acc[wm][wn] += Areg * Breg[wn];
+				}
+			}
+		}
+
+		barrier(CLK_LOCAL_MEM_FENCE);
+	}
+
+	for (int wm = 0; wm < WPT; wm++) {
+		const int c_row = tile_row + row + wm * RTS;
+		for (int wn = 0; wn < WPT; wn++) {
+			const int c_col = tile_col + col + wn * RTS;
+			if (c_row < M && c_col < N) {
+				C[c_row * N + c_col] = acc[wm][wn];
+			}
+		}
+	}
+}
\ No newline at end of file
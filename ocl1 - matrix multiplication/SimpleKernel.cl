@@ -1,3 +1,15 @@
+// operands stored transposed are read by the macros, A [K x M] with -D TRANS_A and B [N x K] with -D TRANS_B
+#ifdef TRANS_A
+#define A_AT(row, col) A[(col) * M + (row)]
+#else
+#define A_AT(row, col) A[(row) * K + (col)]
+#endif
+#ifdef TRANS_B
+#define B_AT(row, col) B[(col) * K + (row)]
+#else
+#define B_AT(row, col) B[(row) * N + (col)]
+#endif
+
 __kernel void Multiplication(const int N, const int K, const int M, const __global float* A, const __global float* B, __global float* C)
 {
 	// getting work-item IDs with dimension index
@@ -7,7 +19,7 @@ __kernel void Multiplication(const int N, const int K, const int M, const __glob
 	//calculating one current element of result_matrix
 	float result_element = 0.0f;
 	for (int i = 0; i < K; i++) {
-		result_element += A[global_row * K + i] * B[i * N + global_col];
+		result_element += A_AT(global_row, i) * B_AT(i, global_col);
 	}
 	// writing result to result_matrix
 	C[global_row * N + global_col] = result_element;
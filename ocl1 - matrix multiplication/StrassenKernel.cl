@@ -0,0 +1,14 @@
+// C = A + sign * B for views of rows x cols elements, every view is the offset of its first element in the buffer
+// and the row pitch, C may be A or B itself as every work-item reads and writes only its own element
+__kernel void Add(const int rows, const int cols, const __global float* A, const int offset_A, const int lda,
+	const __global float* B, const int offset_B, const int ldb, const float sign, __global float* C, const int offset_C, const int ldc)
+{
+	// getting work-item IDs with dimension index, dimension 0 goes along the rows, so neighbouring work-items
+	// read neighbouring elements
+	const int col = get_global_id(0);
+	const int row = get_global_id(1);
+
+	if (row < rows && col < cols) {
+		C[offset_C + row * ldc + col] = A[offset_A + row * lda + col] + sign * B[offset_B + row * ldb + col];
+	}
+}
\ No newline at end of file
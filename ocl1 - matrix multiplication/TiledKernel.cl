@@ -1,6 +1,36 @@
-__kernel void Multiplication(const int N, const int K, const int M, const __global float* A, const __global float* B, __global float* C)
+// operands stored transposed are read by the macros, A [K x M] with -D TRANS_A and B [N x K] with -D TRANS_B,
+// with -D STRIDED the matrices are views into larger ones given by the offset of the first element and the row pitch
+#ifdef STRIDED
+#define VIEWS , const int offset_A, const int lda, const int offset_B, const int ldb, const int offset_C, const int ldc
+#define A_AT(row, col) A[offset_A + (row) * lda + (col)]
+#define B_AT(row, col) B[offset_B + (row) * ldb + (col)]
+#define C_AT(row, col) C[offset_C + (row) * ldc + (col)]
+#else
+#define VIEWS
+#define C_AT(row, col) C[(row) * N + (col)]
+#ifdef TRANS_A
+#define A_AT(row, col) A[(col) * M + (row)]
+#else
+#define A_AT(row, col) A[(row) * K + (col)]
+#endif
+#ifdef TRANS_B
+#define B_AT(row, col) B[(col) * K + (row)]
+#else
+#define B_AT(row, col) B[(row) * N + (col)]
+#endif
+#endif
+// operands stored as bfloat16 with -D BF16 are the upper halves of floats, they are expanded on loading into local memory
+#ifdef BF16
+#define OPERAND ushort
+#define TO_FLOAT(x) as_float((uint)(x) << 16)
+#else
+#define OPERAND float
+#define TO_FLOAT(x) (x)
+#endif
+
+__kernel void Multiplication(const int N, const int K, const int M, const __global OPERAND* A, const __global OPERAND* B, __global float* C VIEWS)
 {
-	// tile is TSxTS elements
+	// tile is TSxTS elements, the tiles on the edges of the matrices are filled with zeros outside of them
 	
 	// getting work-item IDs with dimension index
 	const int row = get_local_id(0);
@@ -13,12 +43,12 @@ __kernel void Multiplication(const int N, const int K, const int M, const __glob
 	
 	float result_element = 0.0f;
 	
-	const int num_tiles = K/TS;
+	const int num_tiles = (K + TS - 1) / TS;
 	for (int t = 0; t < num_tiles; t++) {
 		const int tiled_row = TS * t + row;
 		const int tiled_col = TS * t + col;
-		Asub[row * TS + col] = A[global_row * K + tiled_col];
-		Bsub[row * TS + col] = B[tiled_row * N + global_col];
+		Asub[row * TS + col] = (global_row < M && tiled_col < K) ? TO_FLOAT(A_AT(global_row, tiled_col)) : 0.0f;
+		Bsub[row * TS + col] = (tiled_row < K && global_col < N) ? TO_FLOAT(B_AT(tiled_row, global_col)) : 0.0f;
 		
 		barrier(CLK_LOCAL_MEM_FENCE);
 		
@@ -29,5 +59,7 @@ __kernel void Multiplication(const int N, const int K, const int M, const __glob
 		barrier(CLK_LOCAL_MEM_FENCE);
 	}
 	
-	C[global_row * N + global_col] = result_element;
+	if (global_row < M && global_col < N) {
+		C_AT(global_row, global_col) = result_element;
+	}
 }
\ No newline at end of file
@@ -0,0 +1,23 @@
+// out [cols x rows] is in [rows x cols] transposed, a TSxTS tile goes through local memory so that both reading
+// and writing go along the rows, the tile rows are padded by one so that reading its columns does not hit one bank
+__kernel void Transpose(const int rows, const int cols, const __global float* in, __global float* out)
+{
+	// getting work-item IDs with dimension index, dimension 0 goes along the rows of in
+	const int col = get_local_id(0);
+	const int row = get_local_id(1);
+	const int tile_col = TS * get_group_id(0);
+	const int tile_row = TS * get_group_id(1);
+
+	__local float tile[TS][TS + 1];
+
+	if (tile_row + row < rows && tile_col + col < cols) {
+		tile[row][col] = in[(tile_row + row) * cols + tile_col + col];
+	}
+
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// the work-items swap their roles, so neighbouring ones write neighbouring elements of out
+	if (tile_col + row < cols && tile_row + col < rows) {
+		out[(tile_col + row) * rows + tile_row + col] = tile[col][row];
+	}
+}
\ No newline at end of file
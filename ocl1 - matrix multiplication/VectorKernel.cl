@@ -1,40 +1,68 @@
+// work-group computes a TSxTS tile of C, each work-item computes WIDTH neighbouring elements of one row,
+// rows of A and B are moved between global and local memory as vectors of WIDTH floats,
+// vectors crossing the edges of the matrices are moved element by element with zeros outside of them
+#define JOIN_NAMES(a, b) a##b
+#define JOIN(a, b) JOIN_NAMES(a, b)
+#define floatW JOIN(float, WIDTH)
+#define vloadW JOIN(vload, WIDTH)
+#define vstoreW JOIN(vstore, WIDTH)
+
 __kernel void Multiplication(const int N, const int K, const int M, const __global float* A, const __global float* B, __global float* C)
 {
-	// tile is TSxTS elements
-	
-	// const int VS = 4;
-	float4 inter_sum = (float4)(0.0f, 0.0f, 0.0f, 0.0f);
-	
-	// getting work-item IDs with dimension index
-	const int row = get_local_id(0);
-	const int col = get_local_id(1);
-	const int global_row = get_global_id(1);
-	const int global_col = get_global_id(0);
-	
-	__local float Asub[TS * TS];
-	__local float Bsub[TS * TS];
-	
-	const int Astart = K * TS * get_group_id(1);
-	const int Aend = Astart + K - 1;
-	const int Bstart = TS * get_group_id(0);
-	
-	for (int a = Astart, b = Bstart; a <= Aend; a += TS, b += TS * N) {
-		Asub[row * TS + col] = A[a + K * col + row];
-		Bsub[row * TS + col] = B[b + N * col + row];
-		
+	// getting work-item IDs with dimension index, dimension 0 goes along the vectors of a row
+	const int col = get_local_id(0);
+	const int row = get_local_id(1);
+	const int tile_col = TS * get_group_id(0);
+	const int tile_row = TS * get_group_id(1);
+
+	__local float Asub[TS][TS];
+	__local floatW Bsub[TS][TS / WIDTH];
+
+	floatW result_vector = (floatW)(0.0f);
+
+	const int a_row = tile_row + row;
+	const int b_col = tile_col + col * WIDTH;
+	float elements[WIDTH];
+
+	const int num_tiles = (K + TS - 1) / TS;
+	for (int t = 0; t < num_tiles; t++) {
+		// every work-item moves one vector of each tile
+		const int a_col = TS * t + col * WIDTH;
+		if (a_row < M && a_col + WIDTH <= K) {
+			vstoreW(vloadW(0, A + a_row * K + a_col), col, Asub[row]);
+		}
+		else {
+			for (int i = 0; i < WIDTH; i++) {
+				Asub[row][col * WIDTH + i] = (a_row < M && a_col + i < K) ? A[a_row * K + a_col + i] : 0.0f;
+			}
+		}
+		const int b_row = TS * t + row;
+		if (b_row < K && b_col + WIDTH <= N) {
+			Bsub[row][col] = vloadW(0, B + b_row * N + b_col);
+		}
+		else {
+			for (int i = 0; i < WIDTH; i++) {
+				elements[i] = (b_row < K && b_col + i < N) ? B[b_row * N + b_col + i] : 0.0f;
+			}
+			Bsub[row][col] = vloadW(0, elements);
+		}
+
 		barrier(CLK_LOCAL_MEM_FENCE);
-		
-		#pragma unroll
-		for (int t = 0; t < TS; t +=4) {
-			float4 Avector = (float4)(Asub[t * TS + col], Asub[(t + 1) * TS + col], Asub[(t + 2) * TS + col], Asub[(t + 3) * TS + col]);
-			float4 Bvector = (float4)(Bsub[row * TS + t], Bsub[row * TS + (t + 1)], Bsub[row * TS + (t + 2)], Bsub[row * TS + (t + 3)]);
-			barrier(CLK_LOCAL_MEM_FENCE);
-			inter_sum += Avector * Bvector;
+
+		for (int k = 0; k < TS; k++) {
+			result_vector += Asub[row][k] * Bsub[k][col];
 		}
-		
+
 		barrier(CLK_LOCAL_MEM_FENCE);
 	}
-	
-	// float4(float x, float y, float z, float w)
-	C[global_row * N + global_col] = inter_sum.x + inter_sum.y + inter_sum.z + inter_sum.w;
+
+	if (a_row < M && b_col + WIDTH <= N) {
+		vstoreW(result_vector, 0, C + a_row * N + b_col);
+	}
+	else if (a_row < M) {
+		vstoreW(result_vector, 0, elements);
+		for (int i = 0; i < WIDTH && b_col + i < N; i++) {
+			C[a_row * N + b_col + i] = elements[i];
+		}
+	}
 }
\ No newline at end of file
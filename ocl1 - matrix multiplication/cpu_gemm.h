@@ -0,0 +1,126 @@
+#pragma once
+
+// multiplication on host with OpenMP: realization 0 and the reference of the result check.
+// The matrices are split into blocks which stay in the caches, a block of A [GEMM_MC x GEMM_KC] and a panel of B
+// [GEMM_KC x GEMM_NC] are packed into slivers of GEMM_MR rows and GEMM_NR columns, so the micro-kernel reads both
+// of them one after another and keeps a GEMM_MR x GEMM_NR tile of C in vector registers
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include <omp.h>
+
+// rows of C computed by the micro-kernel at once
+#define GEMM_MR 8
+// columns of C computed by the micro-kernel at once, the SIMD loop goes along them
+#define GEMM_NR 8
+// depth along K of the packed blocks, a sliver of B stays in L1 cache
+#define GEMM_KC 256
+// rows of the packed block of A, a multiple of GEMM_MR, it stays in L2 cache
+#define GEMM_MC 128
+// columns of the packed panel of B shared by all threads, a multiple of GEMM_NT, it stays in L3 cache
+#define GEMM_NC 4096
+// columns of the panel a thread computes with one packed block of A, a multiple of GEMM_NR
+#define GEMM_NT 256
+
+// rows [row, row + mc) and columns [col, col + kc) of A [m x k] by slivers of GEMM_MR rows, zeros after the last row
+inline void PackA(const float* A, size_t k, size_t row, size_t col, size_t mc, size_t kc, float* packed) {
+	for (size_t i = 0; i < mc; i += GEMM_MR) {
+		for (size_t p = 0; p < kc; p++) {
+			for (size_t r = 0; r < GEMM_MR; r++) {
+				packed[r] = i + r < mc ? A[(row + i + r) * k + col + p] : 0.0f;
+			}
+			packed += GEMM_MR;
+		}
+	}
+}
+
+// sliver of GEMM_NR columns [col, col + nr) and rows [row, row + kc) of B [k x n], zeros after the last column
+inline void PackBSliver(const float* B, size_t n, size_t row, size_t col, size_t nr, size_t kc, float* packed) {
+	for (size_t p = 0; p < kc; p++) {
+		const float* b = B + (row + p) * n + col;
+		for (size_t c = 0; c < GEMM_NR; c++) {
+			packed[c] = c < nr ? b[c] : 0.0f;
+		}
+		packed += GEMM_NR;
+	}
+}
+
+// tile [mr x nr] of C with leading dimension ldc from packed slivers of A and B,
+// the first block along K writes the tile and the next ones add to it
+inline void MicroKernel(size_t kc, const float* a, const float* b, float* C, size_t ldc, size_t mr, size_t nr, bool first) {
+	float tile[GEMM_MR][GEMM_NR] = {};
+	for (size_t p = 0; p < kc; p++) {
+		for (size_t r = 0; r < GEMM_MR; r++) {
+			const float a_element = a[r];
+			#pragma omp simd
+			for (size_t c = 0; c < GEMM_NR; c++) {
+				tile[r][c] += a_element * b[c];
+			}
+		}
+		a += GEMM_MR;
+		b += GEMM_NR;
+	}
+	for (size_t r = 0; r < mr; r++) {
+		float* c_row = C + r * ldc;
+		for (size_t c = 0; c < nr; c++) {
+			c_row[c] = first ? tile[r][c] : c_row[c] + tile[r][c];
+		}
+	}
+}
+
+// C [m x n] = A [m x k] * B [k x n], the matrices are stored by rows
+inline void CpuGemm(const float* A, const float* B, float* C, size_t m, size_t k, size_t n) {
+
+	if (k == 0) {
+		memset(C, 0, sizeof(float) * m * n);
+		return;
+	}
+
+	std::vector<float> packed_B(GEMM_KC * GEMM_NC);
+	const int row_blocks = (int)((m + GEMM_MC - 1) / GEMM_MC);
+
+	#pragma omp parallel
+	{
+		std::vector<float> packed_A(GEMM_MC * GEMM_KC);
+		for (size_t jc = 0; jc < n; jc += GEMM_NC) {
+			const size_t nc = std::min((size_t)GEMM_NC, n - jc);
+			const int slivers = (int)((nc + GEMM_NR - 1) / GEMM_NR);
+			const int column_parts = (int)((nc + GEMM_NT - 1) / GEMM_NT);
+
+			for (size_t pc = 0; pc < k; pc += GEMM_KC) {
+				const size_t kc = std::min((size_t)GEMM_KC, k - pc);
+
+				#pragma omp for schedule(static)
+				for (int s = 0; s < slivers; s++) {
+					size_t col = s * GEMM_NR;
+					PackBSliver(B, n, pc, jc + col, std::min((size_t)GEMM_NR, nc - col), kc, packed_B.data() + col * kc);
+				}
+
+				// a task is a block of rows and a part of the panel columns, the threads repack a block of A
+				// only when their next task is in another block of rows
+				int packed_block = -1;
+				#pragma omp for schedule(static)
+				for (int task = 0; task < row_blocks * column_parts; task++) {
+					const int block = task / column_parts;
+					const size_t ic = (size_t)block * GEMM_MC;
+					const size_t mc = std::min((size_t)GEMM_MC, m - ic);
+					if (block != packed_block) {
+						PackA(A, k, ic, pc, mc, kc, packed_A.data());
+						packed_block = block;
+					}
+					const size_t part_begin = (size_t)(task % column_parts) * GEMM_NT;
+					const size_t part_end = std::min(part_begin + GEMM_NT, nc);
+					for (size_t jr = part_begin; jr < part_end; jr += GEMM_NR) {
+						for (size_t ir = 0; ir < mc; ir += GEMM_MR) {
+							MicroKernel(kc, packed_A.data() + ir * kc, packed_B.data() + jr * kc, C + (ic + ir) * n + jc + jr, n,
+								std::min((size_t)GEMM_MR, mc - ir), std::min((size_t)GEMM_NR, nc - jr), pc == 0);
+						}
+					}
+				}
+			}
+		}
+	}
+
+}
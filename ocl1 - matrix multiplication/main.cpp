@@ -4,6 +4,13 @@
 #include <fstream>
 #include <string>
 #include <list>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cmath>
 
 #define CL_TARGET_OPENCL_VERSION 120
 
@@ -14,9 +21,45 @@
 #pragma comment(lib, "opencl.lib")
 #endif
 
+#include "../common/host_array.h"
+#include "../common/program_cache.h"
+#include "cpu_gemm.h"
+
 using namespace std;
 
-cl_device_id GetDevice(int device) {
+// elements of C along each dimension computed by one work-item of realization 4
+#define WORK_PER_THREAD 4
+// steps along K loaded into local memory at once by realization 4
+#define TILE_DEPTH 16
+// floats in a vector of realization 3, 2, 4, 8 or 16
+#define VECTOR_WIDTH 4
+// best configurations found by the tune mode, one line per device, driver version and realization
+#define TUNING_FILE "tuning_cache.txt"
+// side of the square matrices used by the tune mode, all the candidate tiles divide it
+#define TUNE_SIZE 1024
+// runs of every candidate, the fastest one is taken
+#define TUNE_RUNS 3
+// elements of the tuning result compared with the ones computed on host
+#define TUNE_CHECKS 64
+// sets of buffers of the blocked mode, uploading the panels to one of them goes on while the others are computed
+#define BLOCK_BUFFERS 2
+// part of global memory the buffers of the blocked mode may take
+#define BLOCK_MEMORY_PART 0.75
+// rows of C computed by every device to measure its speed in the multi-device mode
+#define CALIBRATION_ROWS 256
+// calibration runs of every device, the fastest one is taken
+#define CALIBRATION_RUNS 2
+// side of the tile of the transposing kernel, it is halved on devices with smaller work-groups
+#define TRANSPOSE_TILE 16
+// largest difference from the host result the check mode accepts, relative to the largest element of the host result
+#define CHECK_TOLERANCE 1e-4
+// smallest side of the products the Strassen mode measures for splitting into quadrants
+#define STRASSEN_MIN_SIZE 64
+// runs of every product and addition measured by the Strassen mode, the fastest one is taken
+#define STRASSEN_RUNS 2
+
+// discrete GPUs, integrated GPUs and CPUs of all the platforms in this order
+list<cl_device_id> GetDevices() {
 
 	// defining lists for discrete and integrated GPUs and CPUs
 	list<cl_device_id> discrete_GPUs;
@@ -56,90 +99,1615 @@ cl_device_id GetDevice(int device) {
 					discrete_GPUs.push_back(devices[j]);
 				}
 			}
-			else if (device_type == CL_DEVICE_TYPE_CPU) {
-				CPUs.push_back(devices[j]); // put an element in the end of list 
+			else if (device_type == CL_DEVICE_TYPE_CPU) {
+				CPUs.push_back(devices[j]); // put an element in the end of list 
+			}
+		}
+		free(devices);
+	}
+	free(platforms);
+
+	devices_res.insert(devices_res.end(), discrete_GPUs.begin(), discrete_GPUs.end()); // adding discrete_GPUs from the first to the last in the end of devices_res
+	devices_res.insert(devices_res.end(), integrated_GPUs.begin(), integrated_GPUs.end());
+	devices_res.insert(devices_res.end(), CPUs.begin(), CPUs.end());
+
+	// cleaning temporary lists
+	discrete_GPUs.clear();
+	integrated_GPUs.clear();
+	CPUs.clear();
+
+	return devices_res;
+
+}
+
+cl_device_id GetDevice(int device) {
+
+	list<cl_device_id> devices_res = GetDevices();
+
+	// checking the provided number of devices
+	if ((device < 0) or (device > (devices_res.size() - 1))) {
+		cerr << "Wrong device number";
+		exit(1);
+	}
+
+	// getting device with provided number
+	auto devices_res_front = devices_res.begin();
+	advance(devices_res_front, device);
+	cl_device_id gotten_device = *devices_res_front;
+
+	// getting its name
+	size_t size;
+	clGetDeviceInfo(gotten_device, CL_DEVICE_NAME, 0, NULL, &size);
+	char* device_name = (char*)malloc(sizeof(char) * size);
+	clGetDeviceInfo(gotten_device, CL_DEVICE_NAME, size, device_name, 0);
+		
+	cout << "Device: " << device_name << "\n";
+
+	return gotten_device;
+
+}
+
+void matrix_out(float* matrix, size_t n, size_t m) {
+
+	cout << "\n";
+	for (int i = 0; i < n; i++) {
+		for (int j = 0; j < m; j++)
+			cout << matrix[i * m + j] << " ";
+		cout << "\n";
+	}
+
+}
+
+// I wrote this function to check results of OpenCL matrix multiplications,
+// result_matrix [m x n] = matrix1 [m x k] * matrix2 [k x n], its previous contents do not matter
+float* SimpleMultiplication(const float* matrix1, const float* matrix2, float* result_matrix, size_t n, size_t k, size_t m) {
+	for (size_t i = 0; i < m; i++)
+	{
+		for (size_t j = 0; j < n; j++)
+		{
+			float sum = 0.0f;
+			for (size_t q = 0; q < k; q++) {
+				sum += matrix1[i * k + q] * matrix2[q * n + j];
+			}
+			result_matrix[i * n + j] = sum;
+		}
+	}
+	return result_matrix;
+}
+
+// [cols x rows] array with the transposed matrix [rows x cols], nullptr if it can not be allocated
+float* TransposedCopy(const float* matrix, size_t rows, size_t cols) {
+	float* transposed = AllocHostArray(rows * cols);
+	if (transposed == nullptr) {
+		return nullptr;
+	}
+	for (size_t i = 0; i < rows; i++) {
+		for (size_t j = 0; j < cols; j++) {
+			transposed[j * rows + i] = matrix[i * cols + j];
+		}
+	}
+	return transposed;
+}
+
+// replaces the operands stored transposed, A [k x m] and B [n x k], with the ones stored by rows for the modes which need them so,
+// false if there is no memory for them
+bool RowMajorOperands(float*& matrix1, float*& matrix2, bool& transposed_A, bool& transposed_B, size_t n, size_t k, size_t m) {
+	if (transposed_A) {
+		float* rows_A = TransposedCopy(matrix1, k, m);
+		if (rows_A == nullptr) {
+			return false;
+		}
+		FreeHostArray(matrix1);
+		matrix1 = rows_A;
+		transposed_A = false;
+	}
+	if (transposed_B) {
+		float* rows_B = TransposedCopy(matrix2, n, k);
+		if (rows_B == nullptr) {
+			return false;
+		}
+		FreeHostArray(matrix2);
+		matrix2 = rows_B;
+		transposed_B = false;
+	}
+	return true;
+}
+
+// nearest bfloat16 with ties to even, the upper half of the float. NaN stays NaN
+cl_ushort FloatToBfloat16(float value) {
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	if ((bits & 0x7fffffff) > 0x7f800000) {
+		return (cl_ushort)((bits >> 16) | 0x40);
+	}
+	bits += 0x7fff + ((bits >> 16) & 1);
+	return (cl_ushort)(bits >> 16);
+}
+
+float Bfloat16ToFloat(cl_ushort value) {
+	uint32_t bits = (uint32_t)value << 16;
+	float result;
+	memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+// replaces count floats of the array with their bfloat16 values packed in its first half,
+// every value is written over floats which are already read
+void PackBfloat16(float* matrix, size_t count) {
+	cl_ushort* packed = (cl_ushort*)matrix;
+	for (size_t i = 0; i < count; i++) {
+		packed[i] = FloatToBfloat16(matrix[i]);
+	}
+}
+
+// largest difference of result_matrix from the one computed on host, realization 0 with SimpleMultiplication and the others
+// with CpuGemm, and its ratio to the largest element of the host result. Operands stored transposed are copied by rows for it,
+// false if there is no memory
+bool CompareWithHost(int realization, const float* matrix1, const float* matrix2, const float* result_matrix, size_t n, size_t k, size_t m,
+	size_t batch_count, bool transposed_A, bool transposed_B, double& max_error, double& relative_error) {
+
+	float* rows_A = transposed_A ? TransposedCopy(matrix1, k, m) : nullptr;
+	float* rows_B = transposed_B ? TransposedCopy(matrix2, n, k) : nullptr;
+	float* reference = AllocHostArray(batch_count * m * n);
+	if (reference == nullptr or (transposed_A and rows_A == nullptr) or (transposed_B and rows_B == nullptr)) {
+		cerr << "Memory can not be allocated for the comparison\n";
+		FreeHostArray(rows_A);
+		FreeHostArray(rows_B);
+		FreeHostArray(reference);
+		return false;
+	}
+	if (transposed_A) {
+		matrix1 = rows_A;
+	}
+	if (transposed_B) {
+		matrix2 = rows_B;
+	}
+	for (size_t b = 0; b < batch_count; b++) {
+		if (realization == 0) {
+			SimpleMultiplication(matrix1 + b * m * k, matrix2 + b * k * n, reference + b * m * n, n, k, m);
+		}
+		else {
+			CpuGemm(matrix1 + b * m * k, matrix2 + b * k * n, reference + b * m * n, m, k, n);
+		}
+	}
+
+	// NaN in the result gives NaN errors
+	max_error = 0.0;
+	double max_element = 0.0;
+	for (size_t i = 0; i < batch_count * m * n; i++) {
+		double error = fabs((double)result_matrix[i] - reference[i]);
+		if (!(error <= max_error)) {
+			max_error = error;
+		}
+		max_element = max(max_element, fabs((double)reference[i]));
+	}
+	FreeHostArray(rows_A);
+	FreeHostArray(rows_B);
+	FreeHostArray(reference);
+
+	relative_error = max_element > 0.0 ? max_error / max_element : max_error;
+	return true;
+
+}
+
+// compares result_matrix with the one computed on host and prints the errors, true if the relative one is within CHECK_TOLERANCE
+bool CheckResult(int realization, const float* matrix1, const float* matrix2, const float* result_matrix, size_t n, size_t k, size_t m,
+	size_t batch_count, bool transposed_A = false, bool transposed_B = false) {
+
+	double max_error, relative_error;
+	if (!CompareWithHost(realization, matrix1, matrix2, result_matrix, n, k, m, batch_count, transposed_A, transposed_B, max_error, relative_error)) {
+		return false;
+	}
+	bool passed = relative_error <= CHECK_TOLERANCE;
+	cout << "Check: max error " << max_error << ", relative " << relative_error << (passed ? " passed" : " FAILED") << "\n";
+	return passed;
+
+}
+
+// parameters of a realization, chosen by the heuristic or read from the tuning file
+struct KernelConfig {
+	int realization;
+	size_t tile_side_size; // side of a work-group
+	size_t work_per_thread; // realization 4
+	size_t vector_width; // realization 3
+	size_t matrices_per_group = 1; // realization 5
+};
+
+const char* KernelFile(int realization) {
+	if (realization == 2) {
+		return "TiledKernel.cl";
+	}
+	if (realization == 3) {
+		return "VectorKernel.cl";
+	}
+	if (realization == 4) {
+		return "RegisterKernel.cl";
+	}
+	if (realization == 5) {
+		return "BatchedKernel.cl";
+	}
+	return "SimpleKernel.cl";
+}
+
+// tile of C computed by a work-group and its depth along K
+void TileSizes(const KernelConfig& config, size_t& tile_mn, size_t& tile_k) {
+	tile_mn = 1;
+	tile_k = 1;
+	if (config.realization == 2 or config.realization == 3 or config.realization == 5) {
+		tile_mn = config.tile_side_size;
+		tile_k = config.tile_side_size;
+	}
+	else if (config.realization == 4) {
+		// a work-item computes work_per_thread x work_per_thread elements, so the tile of C is wider
+		tile_mn = config.tile_side_size * config.work_per_thread;
+		tile_k = TILE_DEPTH;
+	}
+}
+
+string BuildOptions(const KernelConfig& config) {
+	size_t tile_mn, tile_k;
+	TileSizes(config, tile_mn, tile_k);
+	string build_options = "-D TS=" + to_string(tile_mn);
+	if (config.realization == 3) {
+		build_options += " -D WIDTH=" + to_string(config.vector_width);
+	}
+	if (config.realization == 4) {
+		build_options += " -D TSK=" + to_string(tile_k) + " -D WPT=" + to_string(config.work_per_thread);
+	}
+	if (config.realization == 5) {
+		build_options += " -D MPG=" + to_string(config.matrices_per_group);
+	}
+	return build_options;
+}
+
+// NDRange covering the matrices with whole tiles, realization 1 has no local size
+void WorkSizes(const KernelConfig& config, size_t m_global, size_t n_global, size_t* global_size, size_t* local_size) {
+	global_size[0] = m_global;
+	global_size[1] = n_global;
+	local_size[0] = 1;
+	local_size[1] = 1;
+	if (config.realization == 2 or config.realization == 5) {
+		local_size[0] = config.tile_side_size;
+		local_size[1] = config.tile_side_size;
+	}
+	else if (config.realization == 3) {
+		// one work-item for vector_width elements of a row, dimension 0 goes along the columns
+		global_size[0] = n_global / config.vector_width;
+		global_size[1] = m_global;
+		local_size[0] = config.tile_side_size / config.vector_width;
+		local_size[1] = config.tile_side_size;
+	}
+	else if (config.realization == 4) {
+		// one work-item for work_per_thread x work_per_thread elements, dimension 0 goes along the columns
+		global_size[0] = n_global / config.work_per_thread;
+		global_size[1] = m_global / config.work_per_thread;
+		local_size[0] = config.tile_side_size;
+		local_size[1] = config.tile_side_size;
+	}
+}
+
+// the work-group and both tiles in local memory fit the device
+bool ConfigFits(const KernelConfig& config, size_t max_work_group_size, cl_ulong local_memory) {
+	if (config.realization == 1) {
+		return true;
+	}
+	size_t tile_mn, tile_k;
+	TileSizes(config, tile_mn, tile_k);
+	size_t work_group_size = config.tile_side_size * config.tile_side_size;
+	size_t local_floats = 2 * tile_mn * tile_k;
+	if (config.realization == 3) {
+		work_group_size /= config.vector_width;
+	}
+	if (config.realization == 4) {
+		// rows of the A tile are padded by 2
+		local_floats = tile_k * (2 * tile_mn + 2);
+	}
+	if (config.realization == 5) {
+		// a pair of tiles for every pair of matrices of the group
+		work_group_size *= config.matrices_per_group;
+		local_floats *= config.matrices_per_group;
+	}
+	return work_group_size <= max_work_group_size and sizeof(float) * local_floats <= local_memory;
+}
+
+// tile side according to max work group size
+KernelConfig HeuristicConfig(cl_device_id device_id, int realization) {
+
+	KernelConfig config = { realization, 1, WORK_PER_THREAD, VECTOR_WIDTH };
+	if (realization == 1) {
+		return config;
+	}
+
+	size_t local_size;
+	clGetDeviceInfo(device_id, CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(size_t), &local_size, NULL);
+	cl_ulong local_memory;
+	clGetDeviceInfo(device_id, CL_DEVICE_LOCAL_MEM_SIZE, sizeof(cl_ulong), &local_memory, NULL);
+
+	float sqrt_ls = sqrt(local_size);
+	if (sqrt_ls == (float)((int)sqrt_ls)) {
+		config.tile_side_size = sqrt_ls;
+	}
+	else {
+		config.tile_side_size = sqrt(local_size / 2);
+	}
+	if (realization == 3) {
+		// rows of the tiles are moved by whole vectors
+		config.tile_side_size = max(config.tile_side_size - config.tile_side_size % VECTOR_WIDTH, (size_t)VECTOR_WIDTH);
+	}
+	// the tiles of realization 4 are wider, so it is narrowed while they do not fit in local memory
+	while (realization == 4 and config.tile_side_size > 1 and !ConfigFits(config, local_size, local_memory)) {
+		config.tile_side_size /= 2;
+	}
+	return config;
+
+}
+
+// configuration of realization 5 for a batch of [m x n] results: the tile is narrowed down to the matrices,
+// and the work-group takes as many pairs as fit in it and in local memory
+KernelConfig BatchedConfig(cl_device_id device_id, size_t n, size_t m, size_t batch_count) {
+
+	KernelConfig config = HeuristicConfig(device_id, 5);
+	while (config.tile_side_size > 1 and config.tile_side_size / 2 >= max(m, n)) {
+		config.tile_side_size /= 2;
+	}
+
+	size_t local_size;
+	clGetDeviceInfo(device_id, CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(size_t), &local_size, NULL);
+	size_t item_sizes[3];
+	clGetDeviceInfo(device_id, CL_DEVICE_MAX_WORK_ITEM_SIZES, sizeof(item_sizes), item_sizes, NULL);
+	cl_ulong local_memory;
+	clGetDeviceInfo(device_id, CL_DEVICE_LOCAL_MEM_SIZE, sizeof(cl_ulong), &local_memory, NULL);
+
+	size_t tile_area = config.tile_side_size * config.tile_side_size;
+	config.matrices_per_group = min(min(local_size / tile_area, item_sizes[2]), (size_t)(local_memory / (2 * sizeof(float) * tile_area)));
+	config.matrices_per_group = max(min(config.matrices_per_group, batch_count), (size_t)1);
+	return config;
+
+}
+
+// a line of the tuning file: device name, driver version, realization, tile side, work per thread, vector width, time in ms
+bool ReadTunedConfig(const string& device_key, int realization, KernelConfig& config) {
+
+	ifstream tuning(TUNING_FILE);
+	string line;
+	while (getline(tuning, line)) {
+		if (line.compare(0, device_key.size() + 1, device_key + "\t") != 0) {
+			continue;
+		}
+		istringstream fields(line.substr(device_key.size() + 1));
+		KernelConfig tuned;
+		if (fields >> tuned.realization >> tuned.tile_side_size >> tuned.work_per_thread >> tuned.vector_width and tuned.realization == realization) {
+			config = tuned;
+			return true;
+		}
+	}
+	return false;
+
+}
+
+// replaces the lines of the device in the tuning file
+void WriteTunedConfigs(const string& device_key, const vector<KernelConfig>& configs, const vector<double>& times) {
+
+	vector<string> lines;
+	{
+		ifstream tuning(TUNING_FILE);
+		string line;
+		while (getline(tuning, line)) {
+			if (line.compare(0, device_key.size() + 1, device_key + "\t") != 0) {
+				lines.push_back(line);
+			}
+		}
+	}
+
+	ofstream tuning(TUNING_FILE);
+	if (!tuning) {
+		cerr << "Writing tuning file error";
+		exit(1);
+	}
+	for (const string& line : lines) {
+		tuning << line << "\n";
+	}
+	for (size_t i = 0; i < configs.size(); i++) {
+		tuning << device_key << "\t" << configs[i].realization << "\t" << configs[i].tile_side_size << "\t"
+			<< configs[i].work_per_thread << "\t" << configs[i].vector_width << "\t" << times[i] << "\n";
+	}
+
+}
+
+// kernel time in ms of a configuration on the tuning matrices, -1 if it does not build, run or give the right result
+double TimeConfig(cl_context context, cl_command_queue command_queue, cl_device_id device_id, const KernelConfig& config,
+	cl_mem buffer_A, cl_mem buffer_B, cl_mem buffer_C, const vector<float>& check_values) {
+
+	cl_int ret;
+	ifstream kernel_file(KernelFile(config.realization));
+	string kernel_string(istreambuf_iterator<char>(kernel_file), (istreambuf_iterator<char>()));
+
+	bool from_cache;
+	cl_program program = BuildProgramCached(context, device_id, kernel_string, BuildOptions(config), &ret, &from_cache);
+	if (program == NULL) {
+		return -1;
+	}
+	if (ret != CL_SUCCESS) {
+		clReleaseProgram(program);
+		return -1;
+	}
+	cl_kernel kernel = clCreateKernel(program, "Multiplication", &ret);
+	if (ret != CL_SUCCESS) {
+		clReleaseProgram(program);
+		return -1;
+	}
+
+	cl_int size = TUNE_SIZE;
+	clSetKernelArg(kernel, 0, sizeof(cl_int), &size);
+	clSetKernelArg(kernel, 1, sizeof(cl_int), &size);
+	clSetKernelArg(kernel, 2, sizeof(cl_int), &size);
+	clSetKernelArg(kernel, 3, sizeof(cl_mem), &buffer_A);
+	clSetKernelArg(kernel, 4, sizeof(cl_mem), &buffer_B);
+	clSetKernelArg(kernel, 5, sizeof(cl_mem), &buffer_C);
+
+	size_t global_size[2], local_size[2];
+	WorkSizes(config, TUNE_SIZE, TUNE_SIZE, global_size, local_size);
+
+	double best_time = -1;
+	for (int run = 0; run < TUNE_RUNS; run++) {
+		cl_event kernel_event;
+		ret = clEnqueueNDRangeKernel(command_queue, kernel, 2, NULL, global_size, config.realization == 1 ? NULL : local_size, 0, NULL, &kernel_event);
+		if (ret != CL_SUCCESS) {
+			best_time = -1;
+			break;
+		}
+		clWaitForEvents(1, &kernel_event);
+		cl_ulong time_start, time_end;
+		clGetEventProfilingInfo(kernel_event, CL_PROFILING_COMMAND_START, sizeof(time_start), &time_start, NULL);
+		clGetEventProfilingInfo(kernel_event, CL_PROFILING_COMMAND_END, sizeof(time_end), &time_end, NULL);
+		clReleaseEvent(kernel_event);
+		double kernel_time = (time_end - time_start) / 1000000.0;
+		if (best_time < 0 or kernel_time < best_time) {
+			best_time = kernel_time;
+		}
+	}
+
+	// the elements of the tuning matrices are exact in float, so every realization gives the same result
+	if (best_time >= 0) {
+		vector<float> result(TUNE_SIZE * TUNE_SIZE);
+		ret = clEnqueueReadBuffer(command_queue, buffer_C, CL_TRUE, 0, sizeof(float) * result.size(), result.data(), 0, NULL, NULL);
+		for (size_t i = 0; ret == CL_SUCCESS and i < check_values.size(); i++) {
+			size_t idx = i * result.size() / check_values.size();
+			if (result[idx] != check_values[i]) {
+				ret = CL_INVALID_VALUE;
+			}
+		}
+		if (ret != CL_SUCCESS) {
+			best_time = -1;
+		}
+	}
+
+	clReleaseKernel(kernel);
+	clReleaseProgram(program);
+	return best_time;
+
+}
+
+// benchmarks the realizations with their tile sizes, work per thread and vector widths on the device,
+// writes the best configuration of each realization to the tuning file and returns the best one
+KernelConfig Tune(cl_device_id device_id) {
+
+	size_t max_work_group_size;
+	clGetDeviceInfo(device_id, CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(size_t), &max_work_group_size, NULL);
+	cl_ulong local_memory;
+	clGetDeviceInfo(device_id, CL_DEVICE_LOCAL_MEM_SIZE, sizeof(cl_ulong), &local_memory, NULL);
+
+	vector<KernelConfig> candidates;
+	candidates.push_back({ 1, 1, 1, 1 });
+	for (size_t side = 4; side <= 64; side *= 2) {
+		candidates.push_back({ 2, side, 1, 1 });
+		for (size_t width = 2; width <= 16 and width <= side; width *= 2) {
+			candidates.push_back({ 3, side, 1, width });
+		}
+		for (size_t work = 2; work <= 8; work *= 2) {
+			candidates.push_back({ 4, side, work, 1 });
+		}
+	}
+
+	// square matrices with small multiples of 0.25, so the sums are exact in float
+	vector<float> matrix(TUNE_SIZE * TUNE_SIZE);
+	for (size_t i = 0; i < matrix.size(); i++) {
+		matrix[i] = (float)(i % 7) * 0.25f - 0.75f;
+	}
+	vector<float> check_values(TUNE_CHECKS);
+	for (size_t i = 0; i < check_values.size(); i++) {
+		size_t idx = i * matrix.size() / check_values.size();
+		size_t row = idx / TUNE_SIZE, col = idx % TUNE_SIZE;
+		float sum = 0.0f;
+		for (size_t q = 0; q < TUNE_SIZE; q++) {
+			sum += matrix[row * TUNE_SIZE + q] * matrix[q * TUNE_SIZE + col];
+		}
+		check_values[i] = sum;
+	}
+
+	cl_int ret;
+	cl_context context = clCreateContext(NULL, 1, &device_id, NULL, NULL, &ret);
+	if (ret != CL_SUCCESS) {
+		cerr << "Context creation failed";
+		exit(1);
+	}
+	cl_command_queue command_queue = clCreateCommandQueue(context, device_id, CL_QUEUE_PROFILING_ENABLE, &ret);
+	if (ret != CL_SUCCESS) {
+		cerr << "Command queue creation failed";
+		clReleaseContext(context);
+		exit(1);
+	}
+	size_t bytes = sizeof(float) * matrix.size();
+	cl_mem buffer_A = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, bytes, matrix.data(), &ret);
+	cl_mem buffer_B = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, bytes, matrix.data(), &ret);
+	cl_mem buffer_C = clCreateBuffer(context, CL_MEM_WRITE_ONLY, bytes, NULL, &ret);
+	if (buffer_A == NULL or buffer_B == NULL or buffer_C == NULL) {
+		cerr << "Buffer creating failed";
+		if (buffer_A != NULL) clReleaseMemObject(buffer_A);
+		if (buffer_B != NULL) clReleaseMemObject(buffer_B);
+		if (buffer_C != NULL) clReleaseMemObject(buffer_C);
+		clReleaseCommandQueue(command_queue);
+		clReleaseContext(context);
+		exit(1);
+	}
+
+	// the best configuration and its time for every realization
+	vector<KernelConfig> best(4);
+	vector<double> best_time(4, -1);
+	for (const KernelConfig& config : candidates) {
+		if (!ConfigFits(config, max_work_group_size, local_memory)) {
+			continue;
+		}
+		double kernel_time = TimeConfig(context, command_queue, device_id, config, buffer_A, buffer_B, buffer_C, check_values);
+		cout << "Realization " << config.realization << " TS " << config.tile_side_size << " WPT " << config.work_per_thread
+			<< " WIDTH " << config.vector_width << ": ";
+		if (kernel_time < 0) {
+			cout << "failed\n";
+			continue;
+		}
+		cout << kernel_time << " ms\n";
+		int r = config.realization - 1;
+		if (best_time[r] < 0 or kernel_time < best_time[r]) {
+			best[r] = config;
+			best_time[r] = kernel_time;
+		}
+	}
+
+	clReleaseMemObject(buffer_A);
+	clReleaseMemObject(buffer_B);
+	clReleaseMemObject(buffer_C);
+	clReleaseCommandQueue(command_queue);
+	clReleaseContext(context);
+
+	vector<KernelConfig> tuned;
+	vector<double> tuned_time;
+	int fastest = -1;
+	for (int r = 0; r < 4; r++) {
+		if (best_time[r] >= 0) {
+			tuned.push_back(best[r]);
+			tuned_time.push_back(best_time[r]);
+			if (fastest < 0 or best_time[r] < best_time[fastest]) {
+				fastest = r;
+			}
+		}
+	}
+	if (fastest < 0) {
+		cerr << "No configuration works on the device";
+		exit(1);
+	}
+	WriteTunedConfigs(DeviceKey(device_id), tuned, tuned_time);
+
+	cout << "Best: realization " << best[fastest].realization << " TS " << best[fastest].tile_side_size << " WPT "
+		<< best[fastest].work_per_thread << " WIDTH " << best[fastest].vector_width << "\n";
+	return best[fastest];
+
+}
+
+// work sizes of the realization
+void ConfigOut(const KernelConfig& config) {
+	size_t tile_side_size = config.tile_side_size;
+	if (config.realization == 2) {
+		cout << "LOCAL_WORK_SIZE [" << tile_side_size << ", " << tile_side_size << "]" << "\n";
+	}
+	if (config.realization == 3) {
+		cout << "LOCAL_WORK_SIZE [" << tile_side_size / config.vector_width << ", " << tile_side_size << "]" << "\nWI_WORK " << config.vector_width << "\n";
+	}
+	if (config.realization == 4) {
+		cout << "LOCAL_WORK_SIZE [" << tile_side_size << ", " << tile_side_size << "]" << "\nWI_WORK " << config.work_per_thread * config.work_per_thread << "\n";
+	}
+	if (config.realization == 5) {
+		cout << "LOCAL_WORK_SIZE [" << tile_side_size << ", " << tile_side_size << ", " << config.matrices_per_group << "]" << "\n";
+	}
+}
+
+// writing result_matrix [m x n] to file, false if it can not be opened.
+// A batch of several matrices gets its count in the header and the matrices one after another.
+// With column_major result_matrix is C transposed, so its rows are the columns of C and the header keeps the sizes of C
+bool MatrixToFile(const string& file_out, const float* result_matrix, size_t n, size_t m, bool column_major = false, size_t batch_count = 1) {
+
+	// opening output file
+	ofstream output;
+	output.open(file_out);
+	if (!output) {
+		return false;
+	}
+	// writing result_matrix to file
+	if (column_major) {
+		output << m << " " << n;
+	}
+	else {
+		output << n << " " << m;
+	}
+	if (batch_count > 1) {
+		output << " " << batch_count;
+	}
+	output << "\n";
+	
+	// teacher's tests ask for 6 digits after point
+	output << fixed;
+	output.precision(6);
+
+	for (size_t b = 0; b < batch_count; b++) {
+		const float* matrix = result_matrix + b * m * n;
+		for (int i = 0; i < m; i++) {
+			for (int j = 0; j < n; j++) {
+				output << matrix[i * n + j] << " ";
+			}
+			output << "\n";
+		}
+	}
+
+	output.close();
+	return true;
+
+}
+
+// kernel transposing matrices on the device with its tile side, NULL if it can not be built
+cl_kernel TransposeKernel(cl_context context, cl_device_id device_id, cl_program* program, size_t* tile, cl_int* ret) {
+
+	size_t max_work_group_size;
+	clGetDeviceInfo(device_id, CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(size_t), &max_work_group_size, NULL);
+	*tile = TRANSPOSE_TILE;
+	while (*tile > 1 and *tile * *tile > max_work_group_size) {
+		*tile /= 2;
+	}
+
+	ifstream kernel_file("TransposeKernel.cl");
+	string kernel_string(istreambuf_iterator<char>(kernel_file), (istreambuf_iterator<char>()));
+	bool from_cache;
+	*program = BuildProgramCached(context, device_id, kernel_string, "-D TS=" + to_string(*tile), ret, &from_cache);
+	if (*program == NULL) {
+		return NULL;
+	}
+	cl_kernel kernel = NULL;
+	if (*ret == CL_SUCCESS) {
+		kernel = clCreateKernel(*program, "Transpose", ret);
+	}
+	if (*ret != CL_SUCCESS) {
+		clReleaseProgram(*program);
+		*program = NULL;
+		return NULL;
+	}
+	return kernel;
+
+}
+
+// enqueues transposing the buffer [rows x cols] into a new buffer [cols x rows] and returns it, NULL if it fails
+cl_mem TransposeBuffer(cl_context context, cl_command_queue command_queue, cl_kernel kernel, size_t tile, cl_mem buffer,
+	size_t rows, size_t cols, cl_event* event, cl_int* ret) {
+
+	cl_mem transposed = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(float) * rows * cols, NULL, ret);
+	if (*ret != CL_SUCCESS) {
+		return NULL;
+	}
+	cl_int rows_arg = rows, cols_arg = cols;
+	*ret = clSetKernelArg(kernel, 0, sizeof(cl_int), &rows_arg);
+	if (*ret == CL_SUCCESS) {
+		*ret = clSetKernelArg(kernel, 1, sizeof(cl_int), &cols_arg);
+	}
+	if (*ret == CL_SUCCESS) {
+		*ret = clSetKernelArg(kernel, 2, sizeof(cl_mem), &buffer);
+	}
+	if (*ret == CL_SUCCESS) {
+		*ret = clSetKernelArg(kernel, 3, sizeof(cl_mem), &transposed);
+	}
+	// dimension 0 goes along the rows of the buffer
+	size_t global_size[2] = { (cols + tile - 1) / tile * tile, (rows + tile - 1) / tile * tile };
+	size_t local_size[2] = { tile, tile };
+	if (*ret == CL_SUCCESS) {
+		*ret = clEnqueueNDRangeKernel(command_queue, kernel, 2, NULL, global_size, local_size, 0, NULL, event);
+	}
+	if (*ret != CL_SUCCESS) {
+		clReleaseMemObject(transposed);
+		return NULL;
+	}
+	return transposed;
+
+}
+
+// side of the square blocks of C in the blocked mode: the largest one for which the panels of A and B and the block of C
+// fit in one allocation each, and BLOCK_BUFFERS sets of them fit in BLOCK_MEMORY_PART of global memory.
+// It is kept a multiple of the tile while it is not smaller than the tile, the kernels handle the blocks crossing the edges
+size_t BlockSide(cl_device_id device_id, size_t tile_mn, size_t n, size_t k, size_t m) {
+
+	cl_ulong max_alloc, global_memory;
+	clGetDeviceInfo(device_id, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(cl_ulong), &max_alloc, NULL);
+	clGetDeviceInfo(device_id, CL_DEVICE_GLOBAL_MEM_SIZE, sizeof(cl_ulong), &global_memory, NULL);
+
+	size_t block_side = (max(m, n) + tile_mn - 1) / tile_mn * tile_mn;
+	while (block_side > 1) {
+		cl_ulong panel = sizeof(float) * block_side * k;
+		cl_ulong block = sizeof(float) * block_side * block_side;
+		if (panel <= max_alloc and block <= max_alloc and BLOCK_BUFFERS * (2 * panel + block) <= BLOCK_MEMORY_PART * global_memory) {
+			break;
+		}
+		block_side /= 2;
+		if (block_side >= tile_mn) {
+			block_side = (block_side + tile_mn - 1) / tile_mn * tile_mn;
+		}
+	}
+	return block_side;
+
+}
+
+// multiplication by blocks of C for matrices which do not fit in device memory. A block of C needs a panel of rows of A
+// and a panel of columns of B, BLOCK_BUFFERS sets of buffers take the blocks in turn. The panels are uploaded through
+// upload_queue, the kernels go to compute_queue and the blocks of C are read back through readback_queue, the queues are
+// synchronized only by events, so the uploads for the next block and the readback of the previous one overlap the kernel.
+// kernel_time is the sum of the kernels and exec_time is the whole span
+cl_int BlockedMultiplication(cl_context context, cl_device_id device_id, cl_kernel kernel, const KernelConfig& config, size_t block_side,
+	const float* matrix1, const float* matrix2, float* result_matrix, size_t n, size_t k, size_t m, double& kernel_time, double& exec_time) {
+
+	cl_int ret;
+	cl_command_queue queues[3] = {};
+	for (int q = 0; q < 3; q++) {
+		queues[q] = clCreateCommandQueue(context, device_id, CL_QUEUE_PROFILING_ENABLE, &ret);
+		if (ret != CL_SUCCESS) {
+			for (int r = 0; r < q; r++) {
+				clReleaseCommandQueue(queues[r]);
+			}
+			return ret;
+		}
+	}
+	cl_command_queue upload_queue = queues[0], compute_queue = queues[1], readback_queue = queues[2];
+
+	size_t block_m = min(block_side, m);
+	size_t block_n = min(block_side, n);
+	cl_mem buffers_A[BLOCK_BUFFERS] = {}, buffers_B[BLOCK_BUFFERS] = {}, buffers_C[BLOCK_BUFFERS] = {};
+	// panels the buffers keep, they are not uploaded again for the next block with the same rows or columns
+	size_t panel_A[BLOCK_BUFFERS], panel_B[BLOCK_BUFFERS];
+	// latest uploads into the buffers of a set and the readback of the last block computed in it
+	cl_event upload_A[BLOCK_BUFFERS] = {}, upload_B[BLOCK_BUFFERS] = {}, readback[BLOCK_BUFFERS] = {};
+	for (int s = 0; s < BLOCK_BUFFERS and ret == CL_SUCCESS; s++) {
+		buffers_A[s] = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(float) * block_m * k, NULL, &ret);
+		if (ret == CL_SUCCESS) {
+			buffers_B[s] = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(float) * k * block_n, NULL, &ret);
+		}
+		if (ret == CL_SUCCESS) {
+			buffers_C[s] = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(float) * block_m * block_n, NULL, &ret);
+		}
+		panel_A[s] = SIZE_MAX;
+		panel_B[s] = SIZE_MAX;
+	}
+
+	size_t tile_mn, tile_k;
+	TileSizes(config, tile_mn, tile_k);
+	size_t blocks_m = (m + block_m - 1) / block_m;
+	size_t blocks_n = (n + block_n - 1) / block_n;
+	vector<cl_event> kernel_events, transfer_events;
+
+	for (size_t b = 0; b < blocks_m * blocks_n and ret == CL_SUCCESS; b++) {
+		int s = b % BLOCK_BUFFERS;
+		size_t bi = b / blocks_n, bj = b % blocks_n;
+		size_t rows = min(block_m, m - bi * block_m);
+		size_t cols = min(block_n, n - bj * block_n);
+
+		// the buffers of the set are free when the last block computed in them has been read back
+		cl_uint wait_num = readback[s] != NULL ? 1 : 0;
+		const cl_event* wait_list = readback[s] != NULL ? &readback[s] : NULL;
+		if (panel_A[s] != bi) {
+			cl_event event;
+			ret = clEnqueueWriteBuffer(upload_queue, buffers_A[s], CL_FALSE, 0, sizeof(float) * rows * k, matrix1 + bi * block_m * k,
+				wait_num, wait_list, &event);
+			if (ret != CL_SUCCESS) {
+				break;
+			}
+			transfer_events.push_back(event);
+			upload_A[s] = event;
+			panel_A[s] = bi;
+		}
+		if (panel_B[s] != bj) {
+			// columns of B are copied from the rows of the whole matrix into a dense panel
+			size_t buffer_origin[] = { 0, 0, 0 };
+			size_t host_origin[] = { sizeof(float) * bj * block_n, 0, 0 };
+			size_t region[] = { sizeof(float) * cols, k, 1 };
+			cl_event event;
+			ret = clEnqueueWriteBufferRect(upload_queue, buffers_B[s], CL_FALSE, buffer_origin, host_origin, region,
+				sizeof(float) * cols, 0, sizeof(float) * n, 0, matrix2, wait_num, wait_list, &event);
+			if (ret != CL_SUCCESS) {
+				break;
+			}
+			transfer_events.push_back(event);
+			upload_B[s] = event;
+			panel_B[s] = bj;
+		}
+		clFlush(upload_queue);
+
+		cl_int kernel_n = cols, kernel_k = k, kernel_m = rows;
+		clSetKernelArg(kernel, 0, sizeof(cl_int), &kernel_n);
+		clSetKernelArg(kernel, 1, sizeof(cl_int), &kernel_k);
+		clSetKernelArg(kernel, 2, sizeof(cl_int), &kernel_m);
+		clSetKernelArg(kernel, 3, sizeof(cl_mem), &buffers_A[s]);
+		clSetKernelArg(kernel, 4, sizeof(cl_mem), &buffers_B[s]);
+		clSetKernelArg(kernel, 5, sizeof(cl_mem), &buffers_C[s]);
+		size_t global_size[2], local_size[2];
+		WorkSizes(config, (rows + tile_mn - 1) / tile_mn * tile_mn, (cols + tile_mn - 1) / tile_mn * tile_mn, global_size, local_size);
+		// the kernel waits for the panels of its set, uploaded now or for an earlier block, and for the readback
+		// of the last block of C in its set, which it overwrites
+		cl_event kernel_wait[3];
+		cl_uint kernel_wait_num = 0;
+		kernel_wait[kernel_wait_num++] = upload_A[s];
+		kernel_wait[kernel_wait_num++] = upload_B[s];
+		if (readback[s] != NULL) {
+			kernel_wait[kernel_wait_num++] = readback[s];
+		}
+		cl_event kernel_event;
+		ret = clEnqueueNDRangeKernel(compute_queue, kernel, 2, NULL, global_size, config.realization == 1 ? NULL : local_size,
+			kernel_wait_num, kernel_wait, &kernel_event);
+		if (ret != CL_SUCCESS) {
+			break;
+		}
+		kernel_events.push_back(kernel_event);
+		clFlush(compute_queue);
+
+		// reading back the block after its kernel, the next kernel and the uploads for the blocks after it go on meanwhile
+		size_t buffer_origin[] = { 0, 0, 0 };
+		size_t host_origin[] = { sizeof(float) * bj * block_n, bi * block_m, 0 };
+		size_t region[] = { sizeof(float) * cols, rows, 1 };
+		cl_event event;
+		ret = clEnqueueReadBufferRect(readback_queue, buffers_C[s], CL_FALSE, buffer_origin, host_origin, region,
+			sizeof(float) * cols, 0, sizeof(float) * n, 0, result_matrix, 1, &kernel_event, &event);
+		if (ret != CL_SUCCESS) {
+			break;
+		}
+		transfer_events.push_back(event);
+		readback[s] = event;
+		clFlush(readback_queue);
+	}
+
+	// waiting for all enqueued tasks to finish
+	clFinish(upload_queue);
+	clFinish(compute_queue);
+	clFinish(readback_queue);
+
+	kernel_time = 0;
+	cl_ulong first_start = ULLONG_MAX, last_end = 0;
+	for (cl_event event : kernel_events) {
+		cl_ulong time_start, time_end;
+		clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(time_start), &time_start, NULL);
+		clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(time_end), &time_end, NULL);
+		kernel_time += time_end - time_start;
+		first_start = min(first_start, time_start);
+		last_end = max(last_end, time_end);
+		clReleaseEvent(event);
+	}
+	for (cl_event event : transfer_events) {
+		cl_ulong time_start, time_end;
+		clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(time_start), &time_start, NULL);
+		clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(time_end), &time_end, NULL);
+		first_start = min(first_start, time_start);
+		last_end = max(last_end, time_end);
+		clReleaseEvent(event);
+	}
+	exec_time = last_end > first_start ? last_end - first_start : 0;
+
+	for (int s = 0; s < BLOCK_BUFFERS; s++) {
+		if (buffers_A[s] != NULL) clReleaseMemObject(buffers_A[s]);
+		if (buffers_B[s] != NULL) clReleaseMemObject(buffers_B[s]);
+		if (buffers_C[s] != NULL) clReleaseMemObject(buffers_C[s]);
+	}
+	clReleaseCommandQueue(upload_queue);
+	clReleaseCommandQueue(compute_queue);
+	clReleaseCommandQueue(readback_queue);
+	return ret;
+
+}
+
+// one device of the multi-device mode with the rows of C it computes
+struct DevicePart {
+	cl_device_id device_id;
+	KernelConfig config;
+	cl_context context = NULL;
+	cl_command_queue command_queue = NULL;
+	cl_program program = NULL;
+	cl_kernel kernel = NULL;
+	cl_mem buffer_A = NULL, buffer_B = NULL, buffer_C = NULL;
+	size_t row_offset = 0, rows = 0;
+	double row_time = 0; // kernel ms per row of C in the calibration run
+	double kernel_time = 0;
+};
+
+void ReleaseDevicePart(DevicePart& part) {
+	if (part.buffer_A != NULL) clReleaseMemObject(part.buffer_A);
+	if (part.buffer_B != NULL) clReleaseMemObject(part.buffer_B);
+	if (part.buffer_C != NULL) clReleaseMemObject(part.buffer_C);
+	if (part.kernel != NULL) clReleaseKernel(part.kernel);
+	if (part.program != NULL) clReleaseProgram(part.program);
+	if (part.command_queue != NULL) clReleaseCommandQueue(part.command_queue);
+	if (part.context != NULL) clReleaseContext(part.context);
+}
+
+// rows of C are computed from the rows of A in buffer_A, buffer_C gets them, returns the kernel event
+cl_int EnqueuePart(DevicePart& part, size_t rows, size_t n, size_t k, cl_event* kernel_event) {
+	size_t tile_mn, tile_k;
+	TileSizes(part.config, tile_mn, tile_k);
+	cl_int kernel_n = n, kernel_k = k, kernel_m = rows;
+	clSetKernelArg(part.kernel, 0, sizeof(cl_int), &kernel_n);
+	clSetKernelArg(part.kernel, 1, sizeof(cl_int), &kernel_k);
+	clSetKernelArg(part.kernel, 2, sizeof(cl_int), &kernel_m);
+	clSetKernelArg(part.kernel, 3, sizeof(cl_mem), &part.buffer_A);
+	clSetKernelArg(part.kernel, 4, sizeof(cl_mem), &part.buffer_B);
+	clSetKernelArg(part.kernel, 5, sizeof(cl_mem), &part.buffer_C);
+	size_t global_size[2], local_size[2];
+	WorkSizes(part.config, (rows + tile_mn - 1) / tile_mn * tile_mn, (n + tile_mn - 1) / tile_mn * tile_mn, global_size, local_size);
+	return clEnqueueNDRangeKernel(part.command_queue, part.kernel, 2, NULL, global_size, part.config.realization == 1 ? NULL : local_size,
+		0, NULL, kernel_event);
+}
+
+double EventTime(cl_event event) {
+	cl_ulong time_start, time_end;
+	clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(time_start), &time_start, NULL);
+	clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(time_end), &time_end, NULL);
+	return (time_end - time_start) / 1000000.0;
+}
+
+// multiplication on several devices, each of them with its own context and queue computes a block of rows of C.
+// The blocks are proportional to the speed of the devices in a calibration run on the first CALIBRATION_ROWS rows
+cl_int MultiDeviceMultiplication(const vector<cl_device_id>& devices, int realization, const float* matrix1, const float* matrix2,
+	float* result_matrix, size_t n, size_t k, size_t m) {
+
+	cl_int ret = CL_SUCCESS;
+	vector<DevicePart> parts(devices.size());
+	size_t calibration_rows = min(m, (size_t)CALIBRATION_ROWS);
+
+	// every device gets the whole B, A and C are for the calibration rows first
+	for (size_t d = 0; d < devices.size() and ret == CL_SUCCESS; d++) {
+		DevicePart& part = parts[d];
+		part.device_id = devices[d];
+		if (!ReadTunedConfig(DeviceKey(part.device_id), realization, part.config)) {
+			part.config = HeuristicConfig(part.device_id, realization);
+		}
+		part.context = clCreateContext(NULL, 1, &part.device_id, NULL, NULL, &ret);
+		if (ret != CL_SUCCESS) {
+			break;
+		}
+		part.command_queue = clCreateCommandQueue(part.context, part.device_id, CL_QUEUE_PROFILING_ENABLE, &ret);
+		if (ret != CL_SUCCESS) {
+			break;
+		}
+		ifstream kernel_file(KernelFile(realization));
+		string kernel_string(istreambuf_iterator<char>(kernel_file), (istreambuf_iterator<char>()));
+		bool from_cache;
+		part.program = BuildProgramCached(part.context, part.device_id, kernel_string, BuildOptions(part.config), &ret, &from_cache);
+		if (ret != CL_SUCCESS) {
+			break;
+		}
+		part.kernel = clCreateKernel(part.program, "Multiplication", &ret);
+		if (ret != CL_SUCCESS) {
+			break;
+		}
+		part.buffer_B = clCreateBuffer(part.context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(float) * k * n, (void*)matrix2, &ret);
+		if (ret != CL_SUCCESS) {
+			break;
+		}
+		part.buffer_A = clCreateBuffer(part.context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(float) * calibration_rows * k, (void*)matrix1, &ret);
+		if (ret != CL_SUCCESS) {
+			break;
+		}
+		part.buffer_C = clCreateBuffer(part.context, CL_MEM_WRITE_ONLY, sizeof(float) * calibration_rows * n, NULL, &ret);
+	}
+
+	// calibration, the faster of CALIBRATION_RUNS runs is taken as the first one also warms the device up
+	for (size_t d = 0; d < parts.size() and ret == CL_SUCCESS; d++) {
+		parts[d].row_time = -1;
+		for (int run = 0; run < CALIBRATION_RUNS and ret == CL_SUCCESS; run++) {
+			cl_event kernel_event;
+			ret = EnqueuePart(parts[d], calibration_rows, n, k, &kernel_event);
+			if (ret == CL_SUCCESS) {
+				clWaitForEvents(1, &kernel_event);
+				double row_time = EventTime(kernel_event) / calibration_rows;
+				if (parts[d].row_time < 0 or row_time < parts[d].row_time) {
+					parts[d].row_time = row_time;
+				}
+				clReleaseEvent(kernel_event);
+			}
+		}
+	}
+
+	// rows of C proportional to the speed of the devices
+	double speed_sum = 0;
+	for (DevicePart& part : parts) {
+		speed_sum += 1 / max(part.row_time, 1e-9);
+	}
+	size_t row_offset = 0;
+	for (size_t d = 0; d < parts.size() and ret == CL_SUCCESS; d++) {
+		DevicePart& part = parts[d];
+		part.row_offset = row_offset;
+		part.rows = d + 1 == parts.size() ? m - row_offset : min(m - row_offset, (size_t)(m / max(part.row_time, 1e-9) / speed_sum + 0.5));
+		row_offset += part.rows;
+
+		clReleaseMemObject(part.buffer_A);
+		clReleaseMemObject(part.buffer_C);
+		part.buffer_A = NULL;
+		part.buffer_C = NULL;
+		if (part.rows == 0) {
+			continue;
+		}
+		part.buffer_A = clCreateBuffer(part.context, CL_MEM_READ_ONLY, sizeof(float) * part.rows * k, NULL, &ret);
+		if (ret == CL_SUCCESS) {
+			part.buffer_C = clCreateBuffer(part.context, CL_MEM_WRITE_ONLY, sizeof(float) * part.rows * n, NULL, &ret);
+		}
+	}
+
+	// the devices work at the same time, the host waits only after all of them got their commands
+	auto run_begin = chrono::steady_clock::now();
+	vector<cl_event> kernel_events(parts.size(), NULL);
+	for (size_t d = 0; d < parts.size() and ret == CL_SUCCESS; d++) {
+		DevicePart& part = parts[d];
+		if (part.rows == 0) {
+			continue;
+		}
+		ret = clEnqueueWriteBuffer(part.command_queue, part.buffer_A, CL_FALSE, 0, sizeof(float) * part.rows * k, matrix1 + part.row_offset * k, 0, NULL, NULL);
+		if (ret == CL_SUCCESS) {
+			ret = EnqueuePart(part, part.rows, n, k, &kernel_events[d]);
+		}
+		if (ret == CL_SUCCESS) {
+			ret = clEnqueueReadBuffer(part.command_queue, part.buffer_C, CL_FALSE, 0, sizeof(float) * part.rows * n, result_matrix + part.row_offset * n, 0, NULL, NULL);
+		}
+		clFlush(part.command_queue);
+	}
+	for (DevicePart& part : parts) {
+		if (part.command_queue != NULL) {
+			clFinish(part.command_queue);
+		}
+	}
+	double exec_time = chrono::duration<double, milli>(chrono::steady_clock::now() - run_begin).count();
+
+	if (ret == CL_SUCCESS) {
+		// the fastest device in the calibration would compute all the rows alone in m times its time per row
+		double kernel_time = 0, single_time = -1;
+		size_t fastest = 0;
+		for (size_t d = 0; d < parts.size(); d++) {
+			DevicePart& part = parts[d];
+			if (kernel_events[d] != NULL) {
+				part.kernel_time = EventTime(kernel_events[d]);
+			}
+			kernel_time = max(kernel_time, part.kernel_time);
+			if (single_time < 0 or part.row_time * m < single_time) {
+				single_time = part.row_time * m;
+				fastest = d;
 			}
+			size_t size;
+			clGetDeviceInfo(part.device_id, CL_DEVICE_NAME, 0, NULL, &size);
+			string name(size, '\0');
+			clGetDeviceInfo(part.device_id, CL_DEVICE_NAME, size, &name[0], NULL);
+			cout << "Device " << d << " (" << name.c_str() << "): rows " << part.rows << ", time " << part.kernel_time << "\n";
+		}
+		cout << "Time: " << kernel_time << "\t" << exec_time << "\n";
+
+		// the speedup is measured by a run of all the rows on the fastest device, when A and C do not fit in it
+		// the estimate from its calibration is printed instead
+		DevicePart& single = parts[fastest];
+		if (single.buffer_A != NULL) clReleaseMemObject(single.buffer_A);
+		if (single.buffer_C != NULL) clReleaseMemObject(single.buffer_C);
+		single.buffer_C = NULL;
+		cl_int single_ret;
+		single.buffer_A = clCreateBuffer(single.context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(float) * m * k, (void*)matrix1, &single_ret);
+		if (single_ret == CL_SUCCESS) {
+			single.buffer_C = clCreateBuffer(single.context, CL_MEM_WRITE_ONLY, sizeof(float) * m * n, NULL, &single_ret);
+		}
+		cl_event single_event = NULL;
+		if (single_ret == CL_SUCCESS) {
+			single_ret = EnqueuePart(single, m, n, k, &single_event);
+		}
+		if (single_ret == CL_SUCCESS) {
+			clWaitForEvents(1, &single_event);
+			double single_measured = EventTime(single_event);
+			clReleaseEvent(single_event);
+			cout << "Single device time: " << single_measured << "\n";
+			cout << "Speedup: " << (kernel_time > 0 ? single_measured / kernel_time : 0) << "\n";
+		}
+		else {
+			cout << "Estimated speedup: " << (kernel_time > 0 ? single_time / kernel_time : 0) << "\n";
 		}
-		free(devices);
 	}
-	free(platforms);
 
-	devices_res.insert(devices_res.end(), discrete_GPUs.begin(), discrete_GPUs.end()); // adding discrete_GPUs from the first to the last in the end of devices_res
-	devices_res.insert(devices_res.end(), integrated_GPUs.begin(), integrated_GPUs.end());
-	devices_res.insert(devices_res.end(), CPUs.begin(), CPUs.end());
+	for (size_t d = 0; d < parts.size(); d++) {
+		if (kernel_events[d] != NULL) {
+			clReleaseEvent(kernel_events[d]);
+		}
+		ReleaseDevicePart(parts[d]);
+	}
+	return ret;
 
-	// cleaning temporary lists
-	discrete_GPUs.clear();
-	integrated_GPUs.clear();
-	CPUs.clear();
+}
 
-	// checking the provided number of devices
-	if ((device < 0) or (device > (devices_res.size() - 1))) {
-		cerr << "Wrong device number";
-		exit(1);
-	}
+// part of a matrix in a device buffer: offset of its first element and distance between its rows in elements
+struct MatrixView {
+	cl_mem buffer;
+	size_t offset, ld;
+};
 
-	// getting device with provided number
-	auto devices_res_front = devices_res.begin();
-	advance(devices_res_front, device);
-	cl_device_id gotten_device = *devices_res_front;
+// quadrant (row, col) of a square view with the side of 2 * half
+MatrixView Quadrant(const MatrixView& view, size_t half, size_t row, size_t col) {
+	return { view.buffer, view.offset + row * half * view.ld + col * half, view.ld };
+}
 
-	// getting its name
-	size_t size;
-	clGetDeviceInfo(gotten_device, CL_DEVICE_NAME, 0, NULL, &size);
-	char* device_name = (char*)malloc(sizeof(char) * size);
-	clGetDeviceInfo(gotten_device, CL_DEVICE_NAME, size, device_name, 0);
-		
-	cout << "Device: " << device_name << "\n";
+// kernels of the Strassen mode, temporaries X, Y, Z with the side of the quadrants of every level and the events of the kernels
+struct StrassenState {
+	KernelConfig config;
+	cl_command_queue command_queue = NULL;
+	cl_program multiply_program = NULL, add_program = NULL;
+	cl_kernel multiply = NULL, add = NULL;
+	size_t depth = 0;
+	vector<cl_mem> temps;
+	vector<cl_event> events;
+};
 
-	return gotten_device;
+void ReleaseStrassenState(StrassenState& state) {
+	for (cl_event event : state.events) clReleaseEvent(event);
+	for (cl_mem temp : state.temps) if (temp != NULL) clReleaseMemObject(temp);
+	if (state.multiply != NULL) clReleaseKernel(state.multiply);
+	if (state.add != NULL) clReleaseKernel(state.add);
+	if (state.multiply_program != NULL) clReleaseProgram(state.multiply_program);
+	if (state.add_program != NULL) clReleaseProgram(state.add_program);
+	state.events.clear();
+	state.temps.clear();
+}
 
+// time from the start of the first kernel to the end of the last one, the events are released
+double KernelSpan(StrassenState& state) {
+	if (state.events.empty()) {
+		return 0;
+	}
+	cl_ulong time_start, time_end;
+	clGetEventProfilingInfo(state.events.front(), CL_PROFILING_COMMAND_START, sizeof(time_start), &time_start, NULL);
+	clGetEventProfilingInfo(state.events.back(), CL_PROFILING_COMMAND_END, sizeof(time_end), &time_end, NULL);
+	for (cl_event event : state.events) clReleaseEvent(event);
+	state.events.clear();
+	return (time_end - time_start) / 1000000.0;
 }
 
-void matrix_out(float* matrix, size_t n, size_t m) {
+// C [m x n] = A [m x k] * B [k x n] for views, the tiled kernel built with -D STRIDED
+cl_int EnqueueViewMultiplication(StrassenState& state, size_t n, size_t k, size_t m, const MatrixView& A, const MatrixView& B, const MatrixView& C) {
+	size_t tile_mn, tile_k;
+	TileSizes(state.config, tile_mn, tile_k);
+	cl_int args[] = { (cl_int)n, (cl_int)k, (cl_int)m, (cl_int)A.offset, (cl_int)A.ld, (cl_int)B.offset, (cl_int)B.ld, (cl_int)C.offset, (cl_int)C.ld };
+	clSetKernelArg(state.multiply, 0, sizeof(cl_int), &args[0]);
+	clSetKernelArg(state.multiply, 1, sizeof(cl_int), &args[1]);
+	clSetKernelArg(state.multiply, 2, sizeof(cl_int), &args[2]);
+	clSetKernelArg(state.multiply, 3, sizeof(cl_mem), &A.buffer);
+	clSetKernelArg(state.multiply, 4, sizeof(cl_mem), &B.buffer);
+	clSetKernelArg(state.multiply, 5, sizeof(cl_mem), &C.buffer);
+	for (cl_uint i = 3; i < 9; i++) {
+		clSetKernelArg(state.multiply, i + 3, sizeof(cl_int), &args[i]);
+	}
+	size_t global_size[2], local_size[2];
+	WorkSizes(state.config, (m + tile_mn - 1) / tile_mn * tile_mn, (n + tile_mn - 1) / tile_mn * tile_mn, global_size, local_size);
+	state.events.push_back(NULL);
+	cl_int ret = clEnqueueNDRangeKernel(state.command_queue, state.multiply, 2, NULL, global_size, local_size, 0, NULL, &state.events.back());
+	if (ret != CL_SUCCESS) {
+		state.events.pop_back();
+	}
+	return ret;
+}
 
-	cout << "\n";
-	for (int i = 0; i < n; i++) {
-		for (int j = 0; j < m; j++)
-			cout << matrix[i * m + j] << " ";
-		cout << "\n";
+// C = A + sign * B for square views of the side size
+cl_int EnqueueViewAdd(StrassenState& state, size_t size, const MatrixView& A, const MatrixView& B, float sign, const MatrixView& C) {
+	cl_int args[] = { (cl_int)size, (cl_int)A.offset, (cl_int)A.ld, (cl_int)B.offset, (cl_int)B.ld, (cl_int)C.offset, (cl_int)C.ld };
+	clSetKernelArg(state.add, 0, sizeof(cl_int), &args[0]);
+	clSetKernelArg(state.add, 1, sizeof(cl_int), &args[0]);
+	clSetKernelArg(state.add, 2, sizeof(cl_mem), &A.buffer);
+	clSetKernelArg(state.add, 3, sizeof(cl_int), &args[1]);
+	clSetKernelArg(state.add, 4, sizeof(cl_int), &args[2]);
+	clSetKernelArg(state.add, 5, sizeof(cl_mem), &B.buffer);
+	clSetKernelArg(state.add, 6, sizeof(cl_int), &args[3]);
+	clSetKernelArg(state.add, 7, sizeof(cl_int), &args[4]);
+	clSetKernelArg(state.add, 8, sizeof(float), &sign);
+	clSetKernelArg(state.add, 9, sizeof(cl_mem), &C.buffer);
+	clSetKernelArg(state.add, 10, sizeof(cl_int), &args[5]);
+	clSetKernelArg(state.add, 11, sizeof(cl_int), &args[6]);
+	size_t global_size[2] = { size, size };
+	state.events.push_back(NULL);
+	cl_int ret = clEnqueueNDRangeKernel(state.command_queue, state.add, 2, NULL, global_size, NULL, 0, NULL, &state.events.back());
+	if (ret != CL_SUCCESS) {
+		state.events.pop_back();
+	}
+	return ret;
+}
+
+// C = A * B for square views of the side size on a level of the recursion, the tiled kernel multiplies on the level depth.
+// Winograd's form of Strassen's algorithm takes 7 products and 15 additions of the quadrants, S and T are sums of the
+// quadrants of A and B in X and Y, P are the products and U are their sums, the quadrants of C and Z keep them
+cl_int EnqueueStrassen(StrassenState& state, size_t size, size_t level, const MatrixView& A, const MatrixView& B, const MatrixView& C) {
+	if (level == state.depth) {
+		return EnqueueViewMultiplication(state, size, size, size, A, B, C);
 	}
+	size_t h = size / 2;
+	MatrixView A11 = Quadrant(A, h, 0, 0), A12 = Quadrant(A, h, 0, 1), A21 = Quadrant(A, h, 1, 0), A22 = Quadrant(A, h, 1, 1);
+	MatrixView B11 = Quadrant(B, h, 0, 0), B12 = Quadrant(B, h, 0, 1), B21 = Quadrant(B, h, 1, 0), B22 = Quadrant(B, h, 1, 1);
+	MatrixView C11 = Quadrant(C, h, 0, 0), C12 = Quadrant(C, h, 0, 1), C21 = Quadrant(C, h, 1, 0), C22 = Quadrant(C, h, 1, 1);
+	MatrixView X = { state.temps[3 * level], 0, h }, Y = { state.temps[3 * level + 1], 0, h }, Z = { state.temps[3 * level + 2], 0, h };
 
+	cl_int ret = EnqueueViewAdd(state, h, A11, A21, -1, X); // S3 = A11 - A21
+	if (ret == CL_SUCCESS) ret = EnqueueViewAdd(state, h, B22, B12, -1, Y); // T3 = B22 - B12
+	if (ret == CL_SUCCESS) ret = EnqueueStrassen(state, h, level + 1, X, Y, C21); // P7 = S3 * T3
+	if (ret == CL_SUCCESS) ret = EnqueueViewAdd(state, h, A21, A22, 1, X); // S1 = A21 + A22
+	if (ret == CL_SUCCESS) ret = EnqueueViewAdd(state, h, B12, B11, -1, Y); // T1 = B12 - B11
+	if (ret == CL_SUCCESS) ret = EnqueueStrassen(state, h, level + 1, X, Y, C22); // P5 = S1 * T1
+	if (ret == CL_SUCCESS) ret = EnqueueViewAdd(state, h, X, A11, -1, X); // S2 = S1 - A11
+	if (ret == CL_SUCCESS) ret = EnqueueViewAdd(state, h, B22, Y, -1, Y); // T2 = B22 - T1
+	if (ret == CL_SUCCESS) ret = EnqueueStrassen(state, h, level + 1, X, Y, C12); // P6 = S2 * T2
+	if (ret == CL_SUCCESS) ret = EnqueueViewAdd(state, h, A12, X, -1, X); // S4 = A12 - S2
+	if (ret == CL_SUCCESS) ret = EnqueueStrassen(state, h, level + 1, X, B22, C11); // P3 = S4 * B22
+	if (ret == CL_SUCCESS) ret = EnqueueStrassen(state, h, level + 1, A11, B11, Z); // P1 = A11 * B11
+	if (ret == CL_SUCCESS) ret = EnqueueViewAdd(state, h, C12, Z, 1, C12); // U2 = P6 + P1
+	if (ret == CL_SUCCESS) ret = EnqueueViewAdd(state, h, C21, C12, 1, C21); // U3 = P7 + U2
+	if (ret == CL_SUCCESS) ret = EnqueueViewAdd(state, h, C12, C22, 1, C12); // U4 = U2 + P5
+	if (ret == CL_SUCCESS) ret = EnqueueViewAdd(state, h, C22, C21, 1, C22); // C22 = U7 = P5 + U3
+	if (ret == CL_SUCCESS) ret = EnqueueViewAdd(state, h, C12, C11, 1, C12); // C12 = U5 = U4 + P3
+	if (ret == CL_SUCCESS) ret = EnqueueViewAdd(state, h, Y, B21, -1, Y); // T4 = T2 - B21
+	if (ret == CL_SUCCESS) ret = EnqueueStrassen(state, h, level + 1, A22, Y, C11); // P4 = A22 * T4
+	if (ret == CL_SUCCESS) ret = EnqueueViewAdd(state, h, C21, C11, -1, C21); // C21 = U6 = U3 - P4
+	if (ret == CL_SUCCESS) ret = EnqueueStrassen(state, h, level + 1, A12, B21, C11); // P2 = A12 * B21
+	if (ret == CL_SUCCESS) ret = EnqueueViewAdd(state, h, C11, Z, 1, C11); // C11 = U1 = P2 + P1
+	return ret;
 }
 
-// I wrote this function to check results of OpenCL matrix multiplications
-float* SimpleMultiplication(float* matrix1, float* matrix2, float* result_matrix, int n, int k, int m) {
-	for (int i = 0; i < m; i++)
-	{
-		for (int j = 0; j < n; j++)
-		{
-			for (int q = 0; q < k; q++) {
-				result_matrix[i * n + j] += matrix1[i * k + q] * matrix2[q * n + j];
-			}
+// fastest of STRASSEN_RUNS runs of the tiled kernel on the views and of an addition of them, size x size each
+cl_int MeasureStrassenStep(StrassenState& state, size_t size, const MatrixView& A, const MatrixView& B, const MatrixView& C,
+	double& multiply_time, double& add_time) {
+
+	cl_int ret = CL_SUCCESS;
+	multiply_time = add_time = -1;
+	for (int run = 0; run < STRASSEN_RUNS and ret == CL_SUCCESS; run++) {
+		ret = EnqueueViewMultiplication(state, size, size, size, A, B, C);
+		if (ret == CL_SUCCESS) {
+			clFinish(state.command_queue);
+			double time = KernelSpan(state);
+			multiply_time = multiply_time < 0 ? time : min(multiply_time, time);
+			ret = EnqueueViewAdd(state, size, A, B, -1, C);
+		}
+		if (ret == CL_SUCCESS) {
+			clFinish(state.command_queue);
+			double time = KernelSpan(state);
+			add_time = add_time < 0 ? time : min(add_time, time);
 		}
 	}
-	return result_matrix;
+	return ret;
+}
+
+// results of the Strassen mode, the sides of the padded square and of the products split last
+struct StrassenReport {
+	size_t side = 0, depth = 0, crossover = 0;
+	double kernel_time = 0, exec_time = 0, tiled_time = 0;
+	double max_error = 0, relative_error = 0;
+};
+
+// multiplication by the recursion of Strassen and Winograd on one device. The tiled kernel multiplies the operands first,
+// its time is the reference of the speedup and its result is the reference of the error. The crossover is measured on zeros:
+// a level splits the products of the side s while 7 tiled products and 15 additions of the side s / 2 are faster than one
+// of the side s. The operands are padded with zeros to a square of the side 2^depth times the tile, all the quadrants
+// and the temporaries stay on the device between the kernels, only C is read back
+cl_int StrassenMultiplication(cl_device_id device_id, const KernelConfig& config, const float* matrix1, const float* matrix2,
+	float* result_matrix, size_t n, size_t k, size_t m, StrassenReport& report) {
+
+	cl_int ret = CL_SUCCESS;
+	cl_ulong max_alloc, global_memory;
+	clGetDeviceInfo(device_id, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(cl_ulong), &max_alloc, NULL);
+	clGetDeviceInfo(device_id, CL_DEVICE_GLOBAL_MEM_SIZE, sizeof(cl_ulong), &global_memory, NULL);
+	size_t tile_mn, tile_k;
+	TileSizes(config, tile_mn, tile_k);
+
+	StrassenState state;
+	state.config = config;
+	cl_context context = clCreateContext(NULL, 1, &device_id, NULL, NULL, &ret);
+	if (ret != CL_SUCCESS) {
+		return ret;
+	}
+	state.command_queue = clCreateCommandQueue(context, device_id, CL_QUEUE_PROFILING_ENABLE, &ret);
+	if (ret != CL_SUCCESS) {
+		clReleaseContext(context);
+		return ret;
+	}
+	bool from_cache;
+	ifstream multiply_file(KernelFile(2));
+	string multiply_string(istreambuf_iterator<char>(multiply_file), (istreambuf_iterator<char>()));
+	state.multiply_program = BuildProgramCached(context, device_id, multiply_string, BuildOptions(config) + " -D STRIDED", &ret, &from_cache);
+	if (ret == CL_SUCCESS) {
+		state.multiply = clCreateKernel(state.multiply_program, "Multiplication", &ret);
+	}
+	if (ret == CL_SUCCESS) {
+		ifstream add_file("StrassenKernel.cl");
+		string add_string(istreambuf_iterator<char>(add_file), (istreambuf_iterator<char>()));
+		state.add_program = BuildProgramCached(context, device_id, add_string, "", &ret, &from_cache);
+	}
+	if (ret == CL_SUCCESS) {
+		state.add = clCreateKernel(state.add_program, "Add", &ret);
+	}
+
+	// the tiled kernel on the operands as they are
+	cl_mem buffer_A = NULL, buffer_B = NULL, buffer_C = NULL;
+	if (ret == CL_SUCCESS) {
+		buffer_A = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, sizeof(float) * m * k, (void*)matrix1, &ret);
+	}
+	if (ret == CL_SUCCESS) {
+		buffer_B = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR, sizeof(float) * k * n, (void*)matrix2, &ret);
+	}
+	if (ret == CL_SUCCESS) {
+		buffer_C = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(float) * m * n, NULL, &ret);
+	}
+	if (ret == CL_SUCCESS) {
+		ret = EnqueueViewMultiplication(state, n, k, m, { buffer_A, 0, k }, { buffer_B, 0, n }, { buffer_C, 0, n });
+	}
+	if (ret == CL_SUCCESS) {
+		ret = clEnqueueReadBuffer(state.command_queue, buffer_C, CL_TRUE, 0, sizeof(float) * m * n, result_matrix, 0, NULL, NULL);
+		report.tiled_time = KernelSpan(state);
+	}
+	if (buffer_A != NULL) clReleaseMemObject(buffer_A);
+	if (buffer_B != NULL) clReleaseMemObject(buffer_B);
+	if (buffer_C != NULL) clReleaseMemObject(buffer_C);
+	buffer_A = buffer_B = buffer_C = NULL;
+	vector<float> tiled_result(result_matrix, result_matrix + m * n);
+
+	// sides of the products on the levels, halved while they are not smaller than STRASSEN_MIN_SIZE and rounded up to the tile,
+	// the level splits its products when the next level is faster, the first level is compared with the tiled kernel above
+	size_t largest = max(max(m, k), n);
+	vector<size_t> sides;
+	for (size_t side = largest; side >= STRASSEN_MIN_SIZE; side = (side + 1) / 2) {
+		sides.push_back((side + tile_mn - 1) / tile_mn * tile_mn);
+	}
+	vector<double> multiply_times(sides.size(), -1), add_times(sides.size(), -1);
+	if (!sides.empty()) {
+		multiply_times[0] = report.tiled_time;
+	}
+	if (ret == CL_SUCCESS and sides.size() > 1) {
+		size_t bytes = sizeof(float) * sides[1] * sides[1];
+		buffer_A = clCreateBuffer(context, CL_MEM_READ_WRITE, bytes, NULL, &ret);
+		if (ret == CL_SUCCESS) {
+			buffer_B = clCreateBuffer(context, CL_MEM_READ_WRITE, bytes, NULL, &ret);
+		}
+		if (ret == CL_SUCCESS) {
+			buffer_C = clCreateBuffer(context, CL_MEM_READ_WRITE, bytes, NULL, &ret);
+		}
+		float zero = 0;
+		if (ret == CL_SUCCESS) {
+			ret = clEnqueueFillBuffer(state.command_queue, buffer_A, &zero, sizeof(float), 0, bytes, 0, NULL, NULL);
+		}
+		if (ret == CL_SUCCESS) {
+			ret = clEnqueueFillBuffer(state.command_queue, buffer_B, &zero, sizeof(float), 0, bytes, 0, NULL, NULL);
+		}
+		for (size_t level = 1; level < sides.size() and ret == CL_SUCCESS; level++) {
+			ret = MeasureStrassenStep(state, sides[level], { buffer_A, 0, sides[level] }, { buffer_B, 0, sides[level] },
+				{ buffer_C, 0, sides[level] }, multiply_times[level], add_times[level]);
+		}
+		if (buffer_A != NULL) clReleaseMemObject(buffer_A);
+		if (buffer_B != NULL) clReleaseMemObject(buffer_B);
+		if (buffer_C != NULL) clReleaseMemObject(buffer_C);
+		buffer_A = buffer_B = buffer_C = NULL;
+	}
+	while (state.depth + 1 < sides.size() and 7 * multiply_times[state.depth + 1] + 15 * add_times[state.depth + 1] < multiply_times[state.depth]) {
+		state.depth++;
+	}
+
+	// padded operands, C and the temporaries of the levels take about 4 squares of the side
+	size_t base = (largest + ((size_t)1 << state.depth) - 1) >> state.depth;
+	report.depth = state.depth;
+	report.side = (base + tile_mn - 1) / tile_mn * tile_mn << state.depth;
+	report.crossover = state.depth > 0 ? report.side >> (state.depth - 1) : 0;
+	size_t side = report.side;
+	if (ret == CL_SUCCESS and state.depth > 0 and (side * side > INT_MAX or sizeof(float) * side * side > max_alloc
+		or sizeof(float) * side * side * 4 > global_memory)) {
+		ret = CL_MEM_OBJECT_ALLOCATION_FAILURE;
+	}
+	if (ret != CL_SUCCESS or state.depth == 0) {
+		// the tiled kernel is not slower than the recursion, its result is taken
+		report.kernel_time = report.exec_time = report.tiled_time;
+		ReleaseStrassenState(state);
+		clReleaseCommandQueue(state.command_queue);
+		clReleaseContext(context);
+		return ret;
+	}
+
+	for (size_t level = 0; level < state.depth and ret == CL_SUCCESS; level++) {
+		size_t half = side >> (level + 1);
+		for (int t = 0; t < 3 and ret == CL_SUCCESS; t++) {
+			state.temps.push_back(clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(float) * half * half, NULL, &ret));
+		}
+	}
+	if (ret == CL_SUCCESS) {
+		buffer_A = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(float) * side * side, NULL, &ret);
+	}
+	if (ret == CL_SUCCESS) {
+		buffer_B = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(float) * side * side, NULL, &ret);
+	}
+	if (ret == CL_SUCCESS) {
+		buffer_C = clCreateBuffer(context, CL_MEM_READ_WRITE, sizeof(float) * side * side, NULL, &ret);
+	}
+
+	// the operands are written into the corners of the zero-filled squares, C is read from its corner
+	auto run_begin = chrono::steady_clock::now();
+	float zero = 0;
+	size_t origin[] = { 0, 0, 0 };
+	size_t region_A[] = { sizeof(float) * k, m, 1 }, region_B[] = { sizeof(float) * n, k, 1 }, region_C[] = { sizeof(float) * n, m, 1 };
+	if (ret == CL_SUCCESS) {
+		ret = clEnqueueFillBuffer(state.command_queue, buffer_A, &zero, sizeof(float), 0, sizeof(float) * side * side, 0, NULL, NULL);
+	}
+	if (ret == CL_SUCCESS) {
+		ret = clEnqueueFillBuffer(state.command_queue, buffer_B, &zero, sizeof(float), 0, sizeof(float) * side * side, 0, NULL, NULL);
+	}
+	if (ret == CL_SUCCESS) {
+		ret = clEnqueueWriteBufferRect(state.command_queue, buffer_A, CL_FALSE, origin, origin, region_A,
+			sizeof(float) * side, 0, sizeof(float) * k, 0, matrix1, 0, NULL, NULL);
+	}
+	if (ret == CL_SUCCESS) {
+		ret = clEnqueueWriteBufferRect(state.command_queue, buffer_B, CL_FALSE, origin, origin, region_B,
+			sizeof(float) * side, 0, sizeof(float) * n, 0, matrix2, 0, NULL, NULL);
+	}
+	if (ret == CL_SUCCESS) {
+		ret = EnqueueStrassen(state, side, 0, { buffer_A, 0, side }, { buffer_B, 0, side }, { buffer_C, 0, side });
+	}
+	if (ret == CL_SUCCESS) {
+		ret = clEnqueueReadBufferRect(state.command_queue, buffer_C, CL_TRUE, origin, origin, region_C,
+			sizeof(float) * side, 0, sizeof(float) * n, 0, result_matrix, 0, NULL, NULL);
+	}
+	clFinish(state.command_queue);
+	report.exec_time = chrono::duration<double, milli>(chrono::steady_clock::now() - run_begin).count();
+	report.kernel_time = KernelSpan(state);
+
+	// error of the recursion relative to the largest element of the tiled result, NaN gives NaN errors
+	double max_element = 0.0;
+	for (size_t i = 0; i < m * n and ret == CL_SUCCESS; i++) {
+		double error = fabs((double)result_matrix[i] - tiled_result[i]);
+		if (!(error <= report.max_error)) {
+			report.max_error = error;
+		}
+		max_element = max(max_element, fabs((double)tiled_result[i]));
+	}
+	report.relative_error = max_element > 0.0 ? report.max_error / max_element : report.max_error;
+
+	if (buffer_A != NULL) clReleaseMemObject(buffer_A);
+	if (buffer_B != NULL) clReleaseMemObject(buffer_B);
+	if (buffer_C != NULL) clReleaseMemObject(buffer_C);
+	ReleaseStrassenState(state);
+	clReleaseCommandQueue(state.command_queue);
+	clReleaseContext(context);
+	return ret;
+
 }
 
 int main(int argc, char* argv[])
 {
-	//input example: MTP_info.exe <device_num> input.txt output.txt <realization_num>
-	if (argc != 5) {
+	//input example: MTP_info.exe <device_num> input.txt output.txt <realization_num> [blocked] [check]
+	// realization 0 multiplies on host with OpenMP and does not use the device,
+	// "check" compares the result with the one computed on host and fails when they differ
+	// realization "tune" benchmarks all the realizations on the device first and multiplies with the fastest one,
+	// "blocked" streams blocks of the matrices through device memory, it is chosen anyway when they do not fit there,
+	// <device_num> may be "all" or numbers separated by commas to split the rows of C between several devices
+	// realization 5 multiplies a batch of small pairs in one launch, its input header is "n k m batch_count"
+	// layout options: "transA" and "transB" read A stored as [k x m] and B stored as [n x k], "colmajor" reads all the matrices
+	// stored by columns and writes C by columns, realizations 1 and 2 are built for the transposed operands and the others get them
+	// transposed on the device, "devtranspose" transposes them on the device for all the realizations.
+	// The headers keep the sizes of the matrices in every layout: "n k m" of the input and "n m" of C [m x n] in the output,
+	// a file stored by columns has a column of its matrix on every line
+	// "bf16" stores and transfers A and B as bfloat16 for realization 2 and reports the error it adds to the float result
+	// "strassen" multiplies by Strassen-Winograd recursion over the kernel of realization 2 and reports its speedup and error
+	if (argc < 5) {
 		cerr << "Wrong number of parameters";
 		exit(1);
 	}
+	bool blocked_mode = false, check = false;
+	bool transposed_A = false, transposed_B = false, column_major = false, device_transpose_mode = false, bfloat16 = false;
+	bool strassen = false;
+	for (int i = 5; i < argc; i++) {
+		if (string(argv[i]) == "blocked") {
+			blocked_mode = true;
+		}
+		else if (string(argv[i]) == "check") {
+			check = true;
+		}
+		else if (string(argv[i]) == "transA") {
+			transposed_A = true;
+		}
+		else if (string(argv[i]) == "transB") {
+			transposed_B = true;
+		}
+		else if (string(argv[i]) == "colmajor") {
+			column_major = true;
+		}
+		else if (string(argv[i]) == "devtranspose") {
+			device_transpose_mode = true;
+		}
+		else if (string(argv[i]) == "bf16") {
+			bfloat16 = true;
+		}
+		else if (string(argv[i]) == "strassen") {
+			strassen = true;
+		}
+		else {
+			cerr << "Wrong parameter " << argv[i];
+			exit(1);
+		}
+	}
 
-	int device_num = stoi(argv[1]);
+	string device_arg = argv[1];
 	string file_in = argv[2];
 	string file_out = argv[3];
-	int realization = stoi(argv[4]);
+	bool tune = string(argv[4]) == "tune";
+	int realization = tune ? -1 : stoi(argv[4]);
 
-	if ((realization < 1) or (realization > 3)) {
+	if (!tune and ((realization < 0) or (realization > 5))) {
 		cerr << "Wrong realization number";
 		exit(1);
 	}
+	if (realization == 0 and blocked_mode) {
+		cerr << "Realization 0 works on host without blocks";
+		exit(1);
+	}
+	if (bfloat16 and (realization != 2 or blocked_mode or device_transpose_mode or device_arg == "all" or device_arg.find(',') != string::npos)) {
+		cerr << "bfloat16 operands are taken by realization 2 on one device without blocks and transposing on the device";
+		exit(1);
+	}
+	if (strassen and (realization != 2 or blocked_mode or bfloat16 or device_arg == "all" or device_arg.find(',') != string::npos)) {
+		cerr << "Strassen mode works with realization 2 on one device without blocks and bfloat16 operands";
+		exit(1);
+	}
+
+	// devices of the multi-device mode
+	vector<cl_device_id> devices;
+	if (realization == 0) {
+		// no device is taken
+	}
+	else if (device_arg == "all") {
+		for (int i = 0; i < GetDevices().size(); i++) {
+			devices.push_back(GetDevice(i));
+		}
+	}
+	else if (device_arg.find(',') != string::npos) {
+		istringstream device_nums(device_arg);
+		string device_num;
+		while (getline(device_nums, device_num, ',')) {
+			devices.push_back(GetDevice(stoi(device_num)));
+		}
+	}
+	if (!devices.empty() and (tune or blocked_mode)) {
+		cerr << "Tuning and blocked mode work with one device";
+		exit(1);
+	}
+	if (realization == 5 and (!devices.empty() or blocked_mode or transposed_A or transposed_B)) {
+		cerr << "Batched realization works with one device without blocks and transposed operands";
+		exit(1);
+	}
+	cl_device_id device_id = NULL;
+	if (realization != 0) {
+		device_id = devices.empty() ? GetDevice(stoi(device_arg)) : devices[0];
+	}
 
-	cl_device_id device_id = GetDevice(device_num);
+	// the configuration tuned on this device is used instead of the heuristic when there is one
+	KernelConfig config = { realization, 1, 1, 1 };
+	if (tune) {
+		config = Tune(device_id);
+		realization = config.realization;
+	}
+	else if (realization == 0) {
+		// host multiplication has no configuration
+	}
+	else if (ReadTunedConfig(DeviceKey(device_id), realization, config)) {
+		cout << "Tuned configuration from " << TUNING_FILE << "\n";
+	}
+	else {
+		config = HeuristicConfig(device_id, realization);
+	}
 
 	//opening input file
 	ifstream input;
@@ -150,83 +1718,184 @@ int main(int argc, char* argv[])
 	}
 	size_t n, k, m;
 	input >> n >> k >> m;
-	// there are matrices [m x k] and [k x n]
-
-	size_t m_global = m;
-	size_t n_global = n;
-	size_t k_global = k;
-	size_t tile_side_size;
-
-	if (realization == 2 or realization == 3) {
-		// getting tile side size according to max work group size
-		size_t local_size;
-		clGetDeviceInfo(device_id, CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(size_t), &local_size, NULL);
-		float sqrt_ls = sqrt(local_size);
-		if (sqrt_ls == (float)((int)sqrt_ls) ) {
-			tile_side_size = sqrt_ls;
-		}
-		else {
-			tile_side_size = sqrt(local_size / 2);
-		}
-
-		// I used m_global, n_global and k_global to get number of tiles to avoid creating new variables
-		m_global = m / tile_side_size;
-		n_global = n / tile_side_size;
-		k_global = k / tile_side_size;
-		if (m_global * tile_side_size < m) {
-			m_global++;
-		}
-		if (n_global * tile_side_size < n) {
-			n_global++;
+	// there are matrices [m x k] and [k x n], realization 5 reads batch_count pairs of them, each A followed by its B
+	size_t batch_count = 1;
+	if (realization == 5) {
+		input >> batch_count;
+		if (batch_count < 1 or batch_count > INT_MAX) {
+			cerr << "Wrong batch count";
+			input.close();
+			exit(1);
 		}
-		if (k_global * tile_side_size < k) {
-			k_global++;
-		}
-		// going back from number of tiles to size
-		m_global *= tile_side_size;
-		n_global *= tile_side_size;
-		k_global *= tile_side_size;
+		config = BatchedConfig(device_id, n, m, batch_count);
 	}
 
-	// making matrix1 and matrix2 able to divide entirely into tiles
-	float* matrix1 = new (nothrow) float[m_global * k_global] {0};
+	// the matrices of a batch are stored one after another
+	float* matrix1 = AllocHostArray(batch_count * m * k);
 	if (matrix1 == nullptr) {
 		cerr << "Memory can not be allocated";
 		input.close();
 		exit(1);
 	}
-	float* matrix2 = new (nothrow) float[k_global * n_global] {0};
+	float* matrix2 = AllocHostArray(batch_count * k * n);
 	if (matrix2 == nullptr) {
 		cerr << "Memory can not be allocated";
-		delete[] matrix1;
+		FreeHostArray(matrix1);
 		input.close();
 		exit(1);
 	}
-	for (int i = 0; i < m; i++) {
-		for (int j = 0; j < k; j++) {
-			input >> matrix1[i * k_global + j];
+	for (size_t b = 0; b < batch_count; b++) {
+		for (size_t i = 0; i < m * k; i++) {
+			input >> matrix1[b * m * k + i];
 		}
-	}
-	for (int i = 0; i < k; i++) {
-		for (int j = 0; j < n; j++) {
-			input >> matrix2[i * n_global + j];
+		for (size_t i = 0; i < k * n; i++) {
+			input >> matrix2[b * k * n + i];
 		}
 	}
 	input.close();
 
-	// matrix_out(matrix1, m_global, k_global);
-	// matrix_out(matrix2, k_global, n_global);
+	// C stored by columns is C transposed stored by rows, it is B transposed times A transposed, and these operands are stored
+	// by rows in the arrays when B and A are stored by columns, so the operands and the sizes swap and C is written by columns,
+	// the output header gets the sizes of C back
+	if (column_major) {
+		swap(matrix1, matrix2);
+		swap(transposed_A, transposed_B);
+		swap(n, m);
+	}
+
+	// the kernels handle the tiles crossing the edges of the matrices, so only the NDRange is rounded up to whole tiles
+	// tile of C computed by a work-group and its depth along K
+	size_t tile_mn, tile_k;
+	TileSizes(config, tile_mn, tile_k);
+	size_t m_global = (m + tile_mn - 1) / tile_mn * tile_mn;
+	size_t n_global = (n + tile_mn - 1) / tile_mn * tile_mn;
 
-	float* result_matrix = new (nothrow) float[m_global * n_global] {0};
+	// matrix_out(matrix1, m, k);
+	// matrix_out(matrix2, k, n);
+
+	float* result_matrix = AllocHostArray(batch_count * m * n);
 	if (result_matrix == nullptr) {
 		cerr << "Memory can not be allocated";
-		delete[] matrix1;
-		delete[] matrix2;
+		FreeHostArray(matrix1);
+		FreeHostArray(matrix2);
+		exit(1);
+	}
+
+	cl_ulong max_alloc = 0, global_memory = 0;
+	if (realization != 0) {
+		clGetDeviceInfo(device_id, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(cl_ulong), &max_alloc, NULL);
+		clGetDeviceInfo(device_id, CL_DEVICE_GLOBAL_MEM_SIZE, sizeof(cl_ulong), &global_memory, NULL);
+	}
+	// the matrices are multiplied by blocks when one of them is larger than an allocation or all of them do not fit in the device
+	bool blocked = realization != 0 and realization != 5 and !strassen and devices.size() <= 1 and (blocked_mode
+		or sizeof(float) * max(max(m * k, k * n), m * n) > max_alloc or sizeof(float) * (m * k + k * n + m * n) > global_memory);
+	// the host, multi-device, blocked and Strassen modes take the operands stored by rows
+	if ((realization == 0 or devices.size() > 1 or blocked or strassen) and !RowMajorOperands(matrix1, matrix2, transposed_A, transposed_B, n, k, m)) {
+		cerr << "Memory can not be allocated";
+		FreeHostArray(matrix1);
+		FreeHostArray(matrix2);
+		FreeHostArray(result_matrix);
 		exit(1);
 	}
 
-	// FOR RESULT VALIDATION
-	// matrix_out(SimpleMultiplication(matrix1, matrix2, result_matrix, n, k, m), m, n);
+	if (realization == 0) {
+		auto begin = chrono::steady_clock::now();
+		CpuGemm(matrix1, matrix2, result_matrix, m, k, n);
+		double exec_time = chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count();
+		cout << "Time: " << exec_time << "\t" << exec_time << "\n";
+		cout << "Threads: " << omp_get_max_threads() << "\n";
+
+		bool check_passed = !check or CheckResult(realization, matrix1, matrix2, result_matrix, n, k, m, batch_count);
+		FreeHostArray(matrix1);
+		FreeHostArray(matrix2);
+		if (!MatrixToFile(file_out, result_matrix, n, m, column_major)) {
+			cerr << "Writing file error";
+			FreeHostArray(result_matrix);
+			exit(1);
+		}
+		FreeHostArray(result_matrix);
+		if (!check_passed) {
+			cerr << "Result check failed";
+			exit(1);
+		}
+		return 0;
+	}
+
+	if (devices.size() > 1) {
+		cl_int ret = MultiDeviceMultiplication(devices, realization, matrix1, matrix2, result_matrix, n, k, m);
+		bool check_passed = ret != CL_SUCCESS or !check or CheckResult(realization, matrix1, matrix2, result_matrix, n, k, m, batch_count);
+		FreeHostArray(matrix1);
+		FreeHostArray(matrix2);
+		if (ret != CL_SUCCESS) {
+			cerr << "Multi-device multiplication failed";
+			cerr << "\n" << ret << "\n";
+			FreeHostArray(result_matrix);
+			exit(1);
+		}
+		if (!MatrixToFile(file_out, result_matrix, n, m, column_major)) {
+			cerr << "Writing file error";
+			FreeHostArray(result_matrix);
+			exit(1);
+		}
+		FreeHostArray(result_matrix);
+		if (!check_passed) {
+			cerr << "Result check failed";
+			exit(1);
+		}
+		return 0;
+	}
+
+	if (strassen) {
+		StrassenReport report;
+		cl_int ret = StrassenMultiplication(device_id, config, matrix1, matrix2, result_matrix, n, k, m, report);
+		bool check_passed = ret != CL_SUCCESS or !check or CheckResult(realization, matrix1, matrix2, result_matrix, n, k, m, batch_count);
+		FreeHostArray(matrix1);
+		FreeHostArray(matrix2);
+		if (ret != CL_SUCCESS) {
+			cerr << "Strassen multiplication failed";
+			cerr << "\n" << ret << "\n";
+			FreeHostArray(result_matrix);
+			exit(1);
+		}
+		cout << "Time: " << report.kernel_time << "\t" << report.exec_time << "\n";
+		ConfigOut(config);
+		if (report.depth > 0) {
+			cout << "Strassen: depth " << report.depth << ", crossover " << report.crossover << ", padded to " << report.side << "\n";
+		}
+		else {
+			cout << "Strassen: the tiled kernel is faster on the whole product\n";
+		}
+		cout << "Tiled kernel: " << report.tiled_time << ", speedup " << (report.kernel_time > 0 ? report.tiled_time / report.kernel_time : 0) << "\n";
+		cout << "Strassen error: max " << report.max_error << ", relative " << report.relative_error << "\n";
+		if (!MatrixToFile(file_out, result_matrix, n, m, column_major)) {
+			cerr << "Writing file error";
+			FreeHostArray(result_matrix);
+			exit(1);
+		}
+		FreeHostArray(result_matrix);
+		if (!check_passed) {
+			cerr << "Result check failed";
+			exit(1);
+		}
+		return 0;
+	}
+
+	if (bfloat16 and blocked) {
+		cerr << "bfloat16 operands do not fit in the device without blocks";
+		FreeHostArray(matrix1);
+		FreeHostArray(matrix2);
+		FreeHostArray(result_matrix);
+		exit(1);
+	}
+	// the batch is not split into blocks
+	if (realization == 5 and (sizeof(float) * batch_count * max(max(m * k, k * n), m * n) > max_alloc
+		or sizeof(float) * batch_count * (m * k + k * n + m * n) > global_memory)) {
+		cerr << "Batch does not fit in the device";
+		FreeHostArray(matrix1);
+		FreeHostArray(matrix2);
+		FreeHostArray(result_matrix);
+		exit(1);
+	}
 
 	cl_int ret; // ret = 0 is OK, otherwise - error of function execution
 
@@ -234,9 +1903,9 @@ int main(int argc, char* argv[])
 	cl_context context = clCreateContext(NULL, 1, &device_id, NULL, NULL, &ret);
 	if (ret != CL_SUCCESS) {
 		cerr << "Context creation failed";
-		delete[] matrix1;
-		delete[] matrix2;
-		delete[] result_matrix;
+		FreeHostArray(matrix1);
+		FreeHostArray(matrix2);
+		FreeHostArray(result_matrix);
 		exit(1);
 	}
 
@@ -246,46 +1915,47 @@ int main(int argc, char* argv[])
 	cl_command_queue command_queue = clCreateCommandQueue(context, device_id, CL_QUEUE_PROFILING_ENABLE, &ret);
 	if (ret != CL_SUCCESS) {
 		cerr << "Command queue creation failed";
-		delete[] matrix1;
-		delete[] matrix2;
-		delete[] result_matrix;
+		FreeHostArray(matrix1);
+		FreeHostArray(matrix2);
+		FreeHostArray(result_matrix);
 		clReleaseContext(context);
 		exit(1);
 	}
 
-	const char* name = "";
-	if (realization == 1) {
-		name = "SimpleKernel.cl";
-	}
-	else if (realization == 2) {
-		name = "TiledKernel.cl";
-	}
-	else if (realization == 3) {
-		name = "VectorKernel.cl";
-	}
+	const char* name = KernelFile(realization);
+
+	// startup time goes from reading the kernel file to creating the kernel
+	auto startup_begin = chrono::steady_clock::now();
 
 	// compiling kernel file
 	ifstream kernel_file(name);
 	string kernel_string(istreambuf_iterator<char>(kernel_file), (istreambuf_iterator<char>()));
-	const char* kernel_code = kernel_string.c_str();
 
-	// program creating
-	cl_program program = clCreateProgramWithSource(context, 1, &kernel_code, NULL, &ret);
+	// program creating and building, the binary of a previous run is taken when the kernel, options and device are the same
+	string build_options = BuildOptions(config);
+	// realizations 1 and 2 are built for the operands stored transposed, the others get them transposed on the device
+	bool device_transpose = (transposed_A or transposed_B) and (device_transpose_mode or (realization != 1 and realization != 2));
+	if (!device_transpose and transposed_A) {
+		build_options += " -D TRANS_A";
+	}
+	if (!device_transpose and transposed_B) {
+		build_options += " -D TRANS_B";
+	}
+	if (bfloat16) {
+		build_options += " -D BF16";
+	}
+	bool from_cache;
+	cl_program program = BuildProgramCached(context, device_id, kernel_string, build_options, &ret, &from_cache);
 
-	if (ret != CL_SUCCESS) {
+	if (program == NULL) {
 		cerr << "Program creation failed";
-		delete[] matrix1;
-		delete[] matrix2;
-		delete[] result_matrix;
+		FreeHostArray(matrix1);
+		FreeHostArray(matrix2);
+		FreeHostArray(result_matrix);
 		clReleaseCommandQueue(command_queue);
 		clReleaseContext(context);
 		exit(1);
 	}
-	//cout << ("-D TS="+to_string(tile_side_size)).c_str();
-	string build_options = "-D TS=" + to_string(tile_side_size);
-	// program building
-	ret = clBuildProgram(program, 0, NULL, build_options.c_str(), NULL, NULL);
-
 	if (ret != CL_SUCCESS) {
 		cerr << "Program building failed";
 		cerr << "\n" << ret << "\n";
@@ -297,9 +1967,9 @@ int main(int argc, char* argv[])
 		fprintf(stderr, "%s\n", buffer);
 		
 
-		delete[] matrix1;
-		delete[] matrix2;
-		delete[] result_matrix;
+		FreeHostArray(matrix1);
+		FreeHostArray(matrix2);
+		FreeHostArray(result_matrix);
 		clReleaseProgram(program);
 		clReleaseCommandQueue(command_queue);
 		clReleaseContext(context);
@@ -312,34 +1982,86 @@ int main(int argc, char* argv[])
 	if (ret != CL_SUCCESS) {
 		cerr << "Kernel creating failed";
 		// cerr << ret;
-		delete[] matrix1;
-		delete[] matrix2;
-		delete[] result_matrix;
+		FreeHostArray(matrix1);
+		FreeHostArray(matrix2);
+		FreeHostArray(result_matrix);
 		clReleaseProgram(program);
 		clReleaseCommandQueue(command_queue);
 		clReleaseContext(context);
 		exit(1);
 	}
+	double startup_time = chrono::duration<double, milli>(chrono::steady_clock::now() - startup_begin).count();
+
+	if (blocked) {
+		size_t block_side = BlockSide(device_id, tile_mn, n, k, m);
+		double kernel_time, exec_time;
+		ret = BlockedMultiplication(context, device_id, kernel, config, block_side, matrix1, matrix2, result_matrix, n, k, m, kernel_time, exec_time);
+		bool check_passed = ret != CL_SUCCESS or !check or CheckResult(realization, matrix1, matrix2, result_matrix, n, k, m, batch_count);
+		FreeHostArray(matrix1);
+		FreeHostArray(matrix2);
+		clReleaseKernel(kernel);
+		clReleaseProgram(program);
+		clReleaseCommandQueue(command_queue);
+		clReleaseContext(context);
+		if (ret != CL_SUCCESS) {
+			cerr << "Blocked multiplication failed";
+			cerr << "\n" << ret << "\n";
+			FreeHostArray(result_matrix);
+			exit(1);
+		}
+
+		cout << "Time: " << kernel_time / 1000000.0 << "\t" << exec_time / 1000000.0 << "\n";
+		cout << "Startup: " << startup_time << (from_cache ? " (cached binary)" : " (built from source)") << "\n";
+		cout << "Blocks [" << min(block_side, m) << ", " << min(block_side, n) << "]\n";
+		ConfigOut(config);
+
+		if (!MatrixToFile(file_out, result_matrix, n, m, column_major)) {
+			cerr << "Writing file error";
+			FreeHostArray(result_matrix);
+			exit(1);
+		}
+		FreeHostArray(result_matrix);
+		if (!check_passed) {
+			cerr << "Result check failed";
+			exit(1);
+		}
+		return 0;
+	}
+
+	// bfloat16 operands take half of the arrays, the floats are kept for the accuracy report
+	vector<float> float_A, float_B;
+	size_t operand_size = sizeof(float);
+	if (bfloat16) {
+		float_A.assign(matrix1, matrix1 + m * k);
+		float_B.assign(matrix2, matrix2 + k * n);
+		PackBfloat16(matrix1, m * k);
+		PackBfloat16(matrix2, k * n);
+		operand_size = sizeof(cl_ushort);
+	}
+
+	// on CPU and integrated GPU devices the buffers work in the host arrays, so the matrices are not copied
+	bool zero_copy = ZeroCopyDevice(device_id);
+	cl_mem_flags host_flag = zero_copy ? CL_MEM_USE_HOST_PTR : 0;
 
 	// creating buffers for matrices (global memory)
-	cl_mem buffer_A = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(float) * m_global * k_global, NULL, &ret);
+	cl_mem buffer_A = clCreateBuffer(context, CL_MEM_READ_ONLY | host_flag, operand_size * batch_count * m * k, zero_copy ? matrix1 : NULL, &ret);
 	if (ret != CL_SUCCESS) {
 		cerr << "Buffer buffer_A creating failed";
-		delete[] matrix1;
-		delete[] matrix2;
-		delete[] result_matrix;
+		FreeHostArray(matrix1);
+		FreeHostArray(matrix2);
+		FreeHostArray(result_matrix);
 		clReleaseKernel(kernel);
 		clReleaseProgram(program);
 		clReleaseCommandQueue(command_queue);
 		clReleaseContext(context);
 		exit(1);
 	}
-	cl_mem buffer_B = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(float) * k_global * n_global, NULL, &ret);
+	cl_mem buffer_B = clCreateBuffer(context, CL_MEM_READ_ONLY | host_flag, operand_size * batch_count * k * n, zero_copy ? matrix2 : NULL, &ret);
 	if (ret != CL_SUCCESS) {
 		cerr << "Buffer buffer_B creating failed";
-		delete[] matrix1;
-		delete[] matrix2;
-		delete[] result_matrix;
+		FreeHostArray(matrix1);
+		FreeHostArray(matrix2);
+		FreeHostArray(result_matrix);
 		clReleaseMemObject(buffer_A);
 		clReleaseKernel(kernel);
 		clReleaseProgram(program);
@@ -347,12 +2069,12 @@ int main(int argc, char* argv[])
 		clReleaseContext(context);
 		exit(1);
 	}
-	cl_mem buffer_C = clCreateBuffer(context, CL_MEM_WRITE_ONLY, sizeof(float) * m_global * n_global, NULL, &ret);
+	cl_mem buffer_C = clCreateBuffer(context, CL_MEM_WRITE_ONLY | host_flag, sizeof(float) * batch_count * m * n, zero_copy ? result_matrix : NULL, &ret);
 	if (ret != CL_SUCCESS) {
 		cerr << "Buffer buffer_C creating failed";
-		delete[] matrix1;
-		delete[] matrix2;
-		delete[] result_matrix;
+		FreeHostArray(matrix1);
+		FreeHostArray(matrix2);
+		FreeHostArray(result_matrix);
 		clReleaseMemObject(buffer_A);
 		clReleaseMemObject(buffer_B);
 		clReleaseKernel(kernel);
@@ -363,17 +2085,64 @@ int main(int argc, char* argv[])
 	}
 
 	// creating events with buffers
-	cl_event kernel_event, read_event, write_event_A, write_event_B;
-	clEnqueueWriteBuffer(command_queue, buffer_A, CL_TRUE, 0, sizeof(float) * m_global * k_global, matrix1, NULL, NULL, &write_event_A);
-	clEnqueueWriteBuffer(command_queue, buffer_B, CL_TRUE, 0, sizeof(float)* k_global * n_global, matrix2, NULL, NULL, &write_event_B);
+	cl_event kernel_event, read_event, write_event_A, write_event_B, unmap_event;
+	if (!zero_copy) {
+		clEnqueueWriteBuffer(command_queue, buffer_A, CL_TRUE, 0, operand_size * batch_count * m * k, matrix1, NULL, NULL, &write_event_A);
+		clEnqueueWriteBuffer(command_queue, buffer_B, CL_TRUE, 0, operand_size * batch_count * k * n, matrix2, NULL, NULL, &write_event_B);
+	}
+
+	// the operands stored transposed are replaced with their buffers stored by rows, the kernel goes after them in the queue.
+	// Released objects live while the enqueued commands use them
+	cl_event transpose_events[2];
+	int transposes = 0;
+	if (device_transpose) {
+		cl_program transpose_program;
+		size_t transpose_tile;
+		cl_kernel transpose_kernel = TransposeKernel(context, device_id, &transpose_program, &transpose_tile, &ret);
+		if (transpose_kernel != NULL and transposed_A) {
+			cl_mem rows_A = TransposeBuffer(context, command_queue, transpose_kernel, transpose_tile, buffer_A, k, m, &transpose_events[transposes], &ret);
+			if (rows_A != NULL) {
+				clReleaseMemObject(buffer_A);
+				buffer_A = rows_A;
+				transposes++;
+			}
+		}
+		if (ret == CL_SUCCESS and transpose_kernel != NULL and transposed_B) {
+			cl_mem rows_B = TransposeBuffer(context, command_queue, transpose_kernel, transpose_tile, buffer_B, n, k, &transpose_events[transposes], &ret);
+			if (rows_B != NULL) {
+				clReleaseMemObject(buffer_B);
+				buffer_B = rows_B;
+				transposes++;
+			}
+		}
+		if (transpose_kernel != NULL) {
+			clReleaseKernel(transpose_kernel);
+			clReleaseProgram(transpose_program);
+		}
+		if (ret != CL_SUCCESS or transpose_kernel == NULL) {
+			cerr << "Transposing on device failed";
+			cerr << "\n" << ret << "\n";
+			FreeHostArray(matrix1);
+			FreeHostArray(matrix2);
+			FreeHostArray(result_matrix);
+			clReleaseMemObject(buffer_A);
+			clReleaseMemObject(buffer_B);
+			clReleaseMemObject(buffer_C);
+			clReleaseKernel(kernel);
+			clReleaseProgram(program);
+			clReleaseCommandQueue(command_queue);
+			clReleaseContext(context);
+			exit(1);
+		}
+	}
 
 	// setting kernel arguments
-	ret = clSetKernelArg(kernel, 0, sizeof(cl_int), &n_global);
+	ret = clSetKernelArg(kernel, 0, sizeof(cl_int), &n);
 	if (ret != CL_SUCCESS) {
 		cerr << "Kernel argument setting failed";
-		delete[] matrix1;
-		delete[] matrix2;
-		delete[] result_matrix;
+		FreeHostArray(matrix1);
+		FreeHostArray(matrix2);
+		FreeHostArray(result_matrix);
 		clReleaseMemObject(buffer_A);
 		clReleaseMemObject(buffer_B);
 		clReleaseMemObject(buffer_C);
@@ -383,12 +2152,12 @@ int main(int argc, char* argv[])
 		clReleaseContext(context);
 		exit(1);
 	}
-	ret = clSetKernelArg(kernel, 1, sizeof(cl_int), &k_global);
+	ret = clSetKernelArg(kernel, 1, sizeof(cl_int), &k);
 	if (ret != CL_SUCCESS) {
 		cerr << "Kernel argument setting failed";
-		delete[] matrix1;
-		delete[] matrix2;
-		delete[] result_matrix;
+		FreeHostArray(matrix1);
+		FreeHostArray(matrix2);
+		FreeHostArray(result_matrix);
 		clReleaseMemObject(buffer_A);
 		clReleaseMemObject(buffer_B);
 		clReleaseMemObject(buffer_C);
@@ -398,12 +2167,12 @@ int main(int argc, char* argv[])
 		clReleaseContext(context);
 		exit(1);
 	}
-	ret = clSetKernelArg(kernel, 2, sizeof(cl_int), &m_global);
+	ret = clSetKernelArg(kernel, 2, sizeof(cl_int), &m);
 	if (ret != CL_SUCCESS) {
 		cerr << "Kernel argument setting failed";
-		delete[] matrix1;
-		delete[] matrix2;
-		delete[] result_matrix;
+		FreeHostArray(matrix1);
+		FreeHostArray(matrix2);
+		FreeHostArray(result_matrix);
 		clReleaseMemObject(buffer_A);
 		clReleaseMemObject(buffer_B);
 		clReleaseMemObject(buffer_C);
@@ -416,9 +2185,9 @@ int main(int argc, char* argv[])
 	ret = clSetKernelArg(kernel, 3, sizeof(cl_mem), &buffer_A);
 	if (ret != CL_SUCCESS) {
 		cerr << "Kernel argument setting failed";
-		delete[] matrix1;
-		delete[] matrix2;
-		delete[] result_matrix;
+		FreeHostArray(matrix1);
+		FreeHostArray(matrix2);
+		FreeHostArray(result_matrix);
 		clReleaseMemObject(buffer_A);
 		clReleaseMemObject(buffer_B);
 		clReleaseMemObject(buffer_C);
@@ -431,9 +2200,9 @@ int main(int argc, char* argv[])
 	ret = clSetKernelArg(kernel, 4, sizeof(cl_mem), &buffer_B);
 	if (ret != CL_SUCCESS) {
 		cerr << "Kernel argument setting failed";
-		delete[] matrix1;
-		delete[] matrix2;
-		delete[] result_matrix;
+		FreeHostArray(matrix1);
+		FreeHostArray(matrix2);
+		FreeHostArray(result_matrix);
 		clReleaseMemObject(buffer_A);
 		clReleaseMemObject(buffer_B);
 		clReleaseMemObject(buffer_C);
@@ -446,9 +2215,9 @@ int main(int argc, char* argv[])
 	ret = clSetKernelArg(kernel, 5, sizeof(cl_mem), &buffer_C);
 	if (ret != CL_SUCCESS) {
 		cerr << "Kernel argument setting failed";
-		delete[] matrix1;
-		delete[] matrix2;
-		delete[] result_matrix;
+		FreeHostArray(matrix1);
+		FreeHostArray(matrix2);
+		FreeHostArray(result_matrix);
 		clReleaseMemObject(buffer_A);
 		clReleaseMemObject(buffer_B);
 		clReleaseMemObject(buffer_C);
@@ -459,21 +2228,41 @@ int main(int argc, char* argv[])
 		exit(1);
 	}
 
-	size_t global_memory_size[] = { m_global, n_global }; // size of global memory
-	if (realization == 1) {
-		// adding kernel to queue
-		ret = clEnqueueNDRangeKernel(command_queue, kernel, 2, NULL, global_memory_size, NULL, 0, NULL, &kernel_event);
-	}
-	else if (realization == 2 or realization == 3) {
-		size_t local_memory_size[] = { tile_side_size, tile_side_size }; // size of local memory
-		// adding kernel to queue
-		ret = clEnqueueNDRangeKernel(command_queue, kernel, 2, NULL, global_memory_size, local_memory_size, 0, NULL, &kernel_event);
+	cl_uint work_dim = 2;
+	size_t global_memory_size[3], local_memory_size[3]; // size of global and local memory
+	WorkSizes(config, m_global, n_global, global_memory_size, local_memory_size);
+	if (realization == 5) {
+		// a work-group for matrices_per_group pairs, it goes over their results by tiles
+		cl_int batch = batch_count;
+		ret = clSetKernelArg(kernel, 6, sizeof(cl_int), &batch);
+		if (ret != CL_SUCCESS) {
+			cerr << "Kernel argument setting failed";
+			FreeHostArray(matrix1);
+			FreeHostArray(matrix2);
+			FreeHostArray(result_matrix);
+			clReleaseMemObject(buffer_A);
+			clReleaseMemObject(buffer_B);
+			clReleaseMemObject(buffer_C);
+			clReleaseKernel(kernel);
+			clReleaseProgram(program);
+			clReleaseCommandQueue(command_queue);
+			clReleaseContext(context);
+			exit(1);
+		}
+		size_t groups = (batch_count + config.matrices_per_group - 1) / config.matrices_per_group;
+		work_dim = 3;
+		global_memory_size[0] = config.tile_side_size;
+		global_memory_size[1] = config.tile_side_size;
+		global_memory_size[2] = groups * config.matrices_per_group;
+		local_memory_size[2] = config.matrices_per_group;
 	}
+	// adding kernel to queue, realization 1 leaves the local size to the runtime
+	ret = clEnqueueNDRangeKernel(command_queue, kernel, work_dim, NULL, global_memory_size, realization == 1 ? NULL : local_memory_size, 0, NULL, &kernel_event);
 	if (ret != CL_SUCCESS) {
 		cerr << "Adding kernel to queue failed";
-		delete[] matrix1;
-		delete[] matrix2;
-		delete[] result_matrix;
+		FreeHostArray(matrix1);
+		FreeHostArray(matrix2);
+		FreeHostArray(result_matrix);
 		clReleaseMemObject(buffer_A);
 		clReleaseMemObject(buffer_B);
 		clReleaseMemObject(buffer_C);
@@ -488,12 +2277,21 @@ int main(int argc, char* argv[])
 	ret = clWaitForEvents(1, &kernel_event);
 
 	// getting result
-	ret = clEnqueueReadBuffer(command_queue, buffer_C, CL_TRUE, 0, sizeof(float) * m_global * n_global, result_matrix, 0, NULL, &read_event);
+	if (zero_copy) {
+		// mapping buffer_C makes the result visible in result_matrix which the buffer works in
+		void* mapped_C = clEnqueueMapBuffer(command_queue, buffer_C, CL_TRUE, CL_MAP_READ, 0, sizeof(float) * batch_count * m * n, 0, NULL, &read_event, &ret);
+		if (ret == CL_SUCCESS) {
+			ret = clEnqueueUnmapMemObject(command_queue, buffer_C, mapped_C, 0, NULL, &unmap_event);
+		}
+	}
+	else {
+		ret = clEnqueueReadBuffer(command_queue, buffer_C, CL_TRUE, 0, sizeof(float) * batch_count * m * n, result_matrix, 0, NULL, &read_event);
+	}
 	if (ret != CL_SUCCESS) {
 		cerr << "Reading result from buffer failed";
-		delete[] matrix1;
-		delete[] matrix2;
-		delete[] result_matrix;
+		FreeHostArray(matrix1);
+		FreeHostArray(matrix2);
+		FreeHostArray(result_matrix);
 		clReleaseMemObject(buffer_A);
 		clReleaseMemObject(buffer_B);
 		clReleaseMemObject(buffer_C);
@@ -504,7 +2302,7 @@ int main(int argc, char* argv[])
 		exit(1);
 	}
 
-	//matrix_out(result_matrix, m_global, n_global);
+	//matrix_out(result_matrix, m, n);
 
 	// waiting for all enqueued tasks to finish
 	clFinish(command_queue);
@@ -516,26 +2314,70 @@ int main(int argc, char* argv[])
 	clGetEventProfilingInfo(kernel_event, CL_PROFILING_COMMAND_END, sizeof(time_end), &time_end, NULL);
 	double kernel_time = time_end - time_start;
 
-	clGetEventProfilingInfo(write_event_A, CL_PROFILING_COMMAND_START, sizeof(time_start), &time_start_2, NULL);
-	clGetEventProfilingInfo(write_event_A, CL_PROFILING_COMMAND_END, sizeof(time_end), &time_end_2, NULL);
-	double exec_time = time_end_2 - time_start_2;
-	clGetEventProfilingInfo(write_event_B, CL_PROFILING_COMMAND_START, sizeof(time_start), &time_start_2, NULL);
-	clGetEventProfilingInfo(write_event_B, CL_PROFILING_COMMAND_END, sizeof(time_end), &time_end_2, NULL);
-	exec_time += time_end_2 - time_start_2;
+	// without copies only mapping and unmapping the result are added to the kernel
+	double exec_time = kernel_time;
+	if (zero_copy) {
+		clGetEventProfilingInfo(unmap_event, CL_PROFILING_COMMAND_START, sizeof(time_start), &time_start_2, NULL);
+		clGetEventProfilingInfo(unmap_event, CL_PROFILING_COMMAND_END, sizeof(time_end), &time_end_2, NULL);
+		exec_time += time_end_2 - time_start_2;
+	}
+	else {
+		clGetEventProfilingInfo(write_event_A, CL_PROFILING_COMMAND_START, sizeof(time_start), &time_start_2, NULL);
+		clGetEventProfilingInfo(write_event_A, CL_PROFILING_COMMAND_END, sizeof(time_end), &time_end_2, NULL);
+		exec_time += time_end_2 - time_start_2;
+		clGetEventProfilingInfo(write_event_B, CL_PROFILING_COMMAND_START, sizeof(time_start), &time_start_2, NULL);
+		clGetEventProfilingInfo(write_event_B, CL_PROFILING_COMMAND_END, sizeof(time_end), &time_end_2, NULL);
+		exec_time += time_end_2 - time_start_2;
+	}
 	clGetEventProfilingInfo(read_event, CL_PROFILING_COMMAND_START, sizeof(time_start), &time_start_2, NULL);
 	clGetEventProfilingInfo(read_event, CL_PROFILING_COMMAND_END, sizeof(time_end), &time_end_2, NULL);
-	exec_time += time_end_2 - time_start_2 + kernel_time;
+	exec_time += time_end_2 - time_start_2;
+	double transpose_time = 0;
+	for (int i = 0; i < transposes; i++) {
+		clGetEventProfilingInfo(transpose_events[i], CL_PROFILING_COMMAND_START, sizeof(time_start), &time_start_2, NULL);
+		clGetEventProfilingInfo(transpose_events[i], CL_PROFILING_COMMAND_END, sizeof(time_end), &time_end_2, NULL);
+		transpose_time += time_end_2 - time_start_2;
+		clReleaseEvent(transpose_events[i]);
+	}
+	exec_time += transpose_time;
 
 	cout << "Time: " << kernel_time / 1000000.0 << "\t" << exec_time / 1000000.0 << "\n";
-	if (realization == 2) {
-		cout << "LOCAL_WORK_SIZE [" << tile_side_size << ", " << tile_side_size << "]" << "\n";
+	if (zero_copy) {
+		cout << "Zero-copy buffers\n";
 	}
-	if (realization == 3) {
-		cout << "LOCAL_WORK_SIZE [" << tile_side_size << ", " << tile_side_size << "]" << "\nWI_WORK 4\n";
+	if (bfloat16) {
+		cout << "bfloat16 operands\n";
+	}
+	cout << "Startup: " << startup_time << (from_cache ? " (cached binary)" : " (built from source)") << "\n";
+	if (device_transpose) {
+		cout << "Transposed on device: " << transpose_time / 1000000.0 << "\n";
 	}
+	else if (transposed_A or transposed_B) {
+		cout << "Kernel built for transposed operands\n";
+	}
+	ConfigOut(config);
 
-	delete[] matrix1;
-	delete[] matrix2;
+	bool check_passed = true;
+	if (bfloat16) {
+		// the error of the bfloat16 operands is measured against the float product, the check takes the product
+		// of the rounded operands, so it tests the kernel only
+		double max_error, relative_error;
+		if (CompareWithHost(realization, float_A.data(), float_B.data(), result_matrix, n, k, m, batch_count, transposed_A, transposed_B, max_error, relative_error)) {
+			cout << "bfloat16 error: max " << max_error << ", relative " << relative_error << "\n";
+		}
+		for (size_t i = 0; i < float_A.size(); i++) {
+			float_A[i] = Bfloat16ToFloat(FloatToBfloat16(float_A[i]));
+		}
+		for (size_t i = 0; i < float_B.size(); i++) {
+			float_B[i] = Bfloat16ToFloat(FloatToBfloat16(float_B[i]));
+		}
+		check_passed = !check or CheckResult(realization, float_A.data(), float_B.data(), result_matrix, n, k, m, batch_count, transposed_A, transposed_B);
+	}
+	else {
+		check_passed = !check or CheckResult(realization, matrix1, matrix2, result_matrix, n, k, m, batch_count, transposed_A, transposed_B);
+	}
+	FreeHostArray(matrix1);
+	FreeHostArray(matrix2);
 	clReleaseMemObject(buffer_A);
 	clReleaseMemObject(buffer_B);
 	clReleaseMemObject(buffer_C);
@@ -544,30 +2386,16 @@ int main(int argc, char* argv[])
 	clReleaseCommandQueue(command_queue);
 	clReleaseContext(context);
 
-	// opening output file
-	ofstream output;
-	output.open(file_out);
-	if (!output) {
+	if (!MatrixToFile(file_out, result_matrix, n, m, column_major, batch_count)) {
 		cerr << "Writing file error";
-		delete[] result_matrix;
+		FreeHostArray(result_matrix);
 		exit(1);
 	}
-	// writing result_matrix to file
-	output << n << " " << m << "\n";
-	
-	// teacher's tests ask for 6 digits after point
-	output << fixed;
-	output.precision(6);
-
-	for (int i = 0; i < m; i++) {
-		for (int j = 0; j < n; j++) {
-			output << result_matrix[i * n_global + j] << " ";
-		}
-		output << "\n";
+	FreeHostArray(result_matrix);
+	if (!check_passed) {
+		cerr << "Result check failed";
+		exit(1);
 	}
-
-	delete[] result_matrix;
-	output.close();
 	
 	return 0;
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <fstream>
 #include <string>
 #include <list>
+#include <chrono>
 
 #define CL_TARGET_OPENCL_VERSION 120
 
@@ -13,6 +14,9 @@
 #pragma comment(lib, "opencl.lib")
 #endif
 
+#include "../common/host_array.h"
+#include "../common/program_cache.h"
+
 using namespace std;
 
 cl_device_id GetDevice(int device) {
@@ -133,7 +137,7 @@ int main(int argc, char* argv[])
 	}
 	string build_options = "-D MAX_WORK_GR=" + to_string(local_size);
 
-	float* array = new (nothrow) float[global_size];
+	float* array = AllocHostArray(global_size);
 	if (array == nullptr) {
 		cerr << "Memory can not be allocated";
 		input.close();
@@ -158,7 +162,7 @@ int main(int argc, char* argv[])
 	cl_context context = clCreateContext(NULL, 1, &device_id, NULL, NULL, &ret);
 	if (ret != CL_SUCCESS) {
 		cerr << "Context creation failed";
-		delete[] array;
+		FreeHostArray(array);
 		exit(1);
 	}
 
@@ -166,28 +170,29 @@ int main(int argc, char* argv[])
 	cl_command_queue command_queue = clCreateCommandQueue(context, device_id, CL_QUEUE_PROFILING_ENABLE, &ret);
 	if (ret != CL_SUCCESS) {
 		cerr << "Command queue creation failed";
-		delete[] array;
+		FreeHostArray(array);
 		clReleaseContext(context);
 		exit(1);
 	}
 	
+	// startup time goes from reading the kernel file to creating the first kernel
+	auto startup_begin = chrono::steady_clock::now();
+
 	// compiling kernel file
 	ifstream kernel_file("Kernel.cl");
 	string kernel_string(istreambuf_iterator<char>(kernel_file), (istreambuf_iterator<char>()));
-	const char* kernel_code = kernel_string.c_str();
 
-	// program creating
-	cl_program program = clCreateProgramWithSource(context, 1, &kernel_code, NULL, &ret);
-	if (ret != CL_SUCCESS) {
+	// program creating and building, the binary of a previous run is taken when the kernel, options and device are the same
+	bool from_cache;
+	cl_program program = BuildProgramCached(context, device_id, kernel_string, build_options, &ret, &from_cache);
+	if (program == NULL) {
 		cerr << "Program creation failed";
-		delete[] array;
+		FreeHostArray(array);
 		clReleaseCommandQueue(command_queue);
 		clReleaseContext(context);
 		exit(1);
 	}
 
-	// program building
-	ret = clBuildProgram(program, 0, NULL, build_options.c_str(), NULL, NULL);
 	if (ret != CL_SUCCESS) {
 		cerr << "Program building failed";
 		cerr << "\n" << ret << "\n";
@@ -198,7 +203,7 @@ int main(int argc, char* argv[])
 		clGetProgramBuildInfo(program, device_id, CL_PROGRAM_BUILD_LOG, sizeof(buffer), buffer, &len);
 		fprintf(stderr, "%s\n", buffer);
 		*/
-		delete[] array;
+		FreeHostArray(array);
 		clReleaseProgram(program);
 		clReleaseCommandQueue(command_queue);
 		clReleaseContext(context);
@@ -210,28 +215,33 @@ int main(int argc, char* argv[])
 	cl_kernel kernel = clCreateKernel(program, "PrefixSum", &ret);
 	if (ret != CL_SUCCESS) {
 		cerr << "Kernel creating failed";
-		delete[] array;
+		FreeHostArray(array);
 		clReleaseProgram(program);
 		clReleaseCommandQueue(command_queue);
 		clReleaseContext(context);
 		exit(1);
 	}
+	double startup_time = chrono::duration<double, milli>(chrono::steady_clock::now() - startup_begin).count();
+
+	// on CPU and integrated GPU devices the buffers work in the host array and the blocks stay on the device
+	// between the kernels, so nothing is copied
+	bool zero_copy = ZeroCopyDevice(device_id);
 
 	// creating buffers for arrays (global memory)
-	cl_mem buffer_in = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(float) * global_size, NULL, &ret);
+	cl_mem buffer_in = clCreateBuffer(context, CL_MEM_READ_ONLY | (zero_copy ? CL_MEM_USE_HOST_PTR : 0), sizeof(float) * global_size, zero_copy ? array : NULL, &ret);
 	if (ret != CL_SUCCESS) {
 		cerr << "Buffer creating failed";
-		delete[] array;
+		FreeHostArray(array);
 		clReleaseKernel(kernel);
 		clReleaseProgram(program);
 		clReleaseCommandQueue(command_queue);
 		clReleaseContext(context);
 		exit(1);
 	}
-	cl_mem buffer_out = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(float) * global_size, NULL, &ret);
+	cl_mem buffer_out = clCreateBuffer(context, zero_copy ? CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR : CL_MEM_READ_ONLY, sizeof(float) * global_size, NULL, &ret);
 	if (ret != CL_SUCCESS) {
 		cerr << "Buffer creating failed";
-		delete[] array;
+		FreeHostArray(array);
 		clReleaseMemObject(buffer_in);
 		clReleaseKernel(kernel);
 		clReleaseProgram(program);
@@ -242,13 +252,15 @@ int main(int argc, char* argv[])
 
 	// creating events with buffers
 	cl_event kernel_event, read_event, write_event;
-	clEnqueueWriteBuffer(command_queue, buffer_in, CL_TRUE, 0, sizeof(float) * n, array, NULL, NULL, &write_event);
+	if (!zero_copy) {
+		clEnqueueWriteBuffer(command_queue, buffer_in, CL_TRUE, 0, sizeof(float) * n, array, NULL, NULL, &write_event);
+	}
 
 	// setting kernel arguments
 	ret = clSetKernelArg(kernel, 0, sizeof(cl_mem), &buffer_in);
 	if (ret != CL_SUCCESS) {
 		cerr << "Kernel argument setting failed";
-		delete[] array;
+		FreeHostArray(array);
 		clReleaseMemObject(buffer_in);
 		clReleaseMemObject(buffer_out);
 		clReleaseKernel(kernel);
@@ -260,7 +272,7 @@ int main(int argc, char* argv[])
 	ret = clSetKernelArg(kernel, 1, sizeof(cl_mem), &buffer_out);
 	if (ret != CL_SUCCESS) {
 		cerr << "Kernel argument setting failed";
-		delete[] array;
+		FreeHostArray(array);
 		clReleaseMemObject(buffer_in);
 		clReleaseMemObject(buffer_out);
 		clReleaseKernel(kernel);
@@ -272,7 +284,7 @@ int main(int argc, char* argv[])
 	ret = clSetKernelArg(kernel, 2, sizeof(cl_int), &global_size);
 	if (ret != CL_SUCCESS) {
 		cerr << "Kernel argument setting failed";
-		delete[] array;
+		FreeHostArray(array);
 		clReleaseMemObject(buffer_in);
 		clReleaseMemObject(buffer_out);
 		clReleaseKernel(kernel);
@@ -287,7 +299,7 @@ int main(int argc, char* argv[])
 	ret = clEnqueueNDRangeKernel(command_queue, kernel, 1, NULL, global_memory_size, local_memory_size, 0, NULL, &kernel_event);
 	if (ret != CL_SUCCESS) {
 		cerr << "Adding kernel to queue failed";
-		delete[] array;
+		FreeHostArray(array);
 		clReleaseMemObject(buffer_in);
 		clReleaseMemObject(buffer_out);
 		clReleaseKernel(kernel);
@@ -300,11 +312,13 @@ int main(int argc, char* argv[])
 	// waiting for event to be completed
 	ret = clWaitForEvents(1, &kernel_event);
 
-	// getting result
-	ret = clEnqueueReadBuffer(command_queue, buffer_out, CL_TRUE, 0, sizeof(float) * n, array, 0, NULL, &read_event);
+	// getting result, without copies the blocks are read by the second kernel from buffer_out
+	if (!zero_copy) {
+		ret = clEnqueueReadBuffer(command_queue, buffer_out, CL_TRUE, 0, sizeof(float) * n, array, 0, NULL, &read_event);
+	}
 	if (ret != CL_SUCCESS) {
 		cerr << "Reading result from buffer failed";
-		delete[] array;
+		FreeHostArray(array);
 		clReleaseMemObject(buffer_in);
 		clReleaseMemObject(buffer_out);
 		clReleaseKernel(kernel);
@@ -318,7 +332,10 @@ int main(int argc, char* argv[])
 	clFinish(command_queue);
 
 	clReleaseMemObject(buffer_in);
-	clReleaseMemObject(buffer_out);
+	cl_mem buffer_blocks = buffer_out;
+	if (!zero_copy) {
+		clReleaseMemObject(buffer_out);
+	}
 	clReleaseKernel(kernel);
 
 	//array_out
@@ -333,28 +350,31 @@ int main(int argc, char* argv[])
 	kernel = clCreateKernel(program, "AddBlocks", &ret);
 	if (ret != CL_SUCCESS) {
 		cerr << "Kernel creating failed";
-		delete[] array;
+		FreeHostArray(array);
+		if (zero_copy) clReleaseMemObject(buffer_blocks);
 		clReleaseProgram(program);
 		clReleaseCommandQueue(command_queue);
 		clReleaseContext(context);
 		exit(1);
 	}
 	// creating buffers for arrays (global memory)
-	buffer_in = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(float) * global_size, NULL, &ret);
-	if (ret != CL_SUCCESS) {
-		cerr << "Buffer creating failed";
-		delete[] array;
-		clReleaseKernel(kernel);
-		clReleaseProgram(program);
-		clReleaseCommandQueue(command_queue);
-		clReleaseContext(context);
-		exit(1);
+	if (zero_copy) {
+		// the result is written to array
+		buffer_in = buffer_blocks;
+		buffer_out = clCreateBuffer(context, CL_MEM_WRITE_ONLY | CL_MEM_USE_HOST_PTR, sizeof(float) * global_size, array, &ret);
+	}
+	else {
+		buffer_in = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(float) * global_size, NULL, &ret);
+		if (ret == CL_SUCCESS) {
+			buffer_out = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(float) * global_size, NULL, &ret);
+			if (ret != CL_SUCCESS) {
+				clReleaseMemObject(buffer_in);
+			}
+		}
 	}
-	buffer_out = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(float) * global_size, NULL, &ret);
 	if (ret != CL_SUCCESS) {
 		cerr << "Buffer creating failed";
-		delete[] array;
-		clReleaseMemObject(buffer_in);
+		FreeHostArray(array);
 		clReleaseKernel(kernel);
 		clReleaseProgram(program);
 		clReleaseCommandQueue(command_queue);
@@ -362,13 +382,15 @@ int main(int argc, char* argv[])
 		exit(1);
 	}
 	// creating events with buffers
-	cl_event kernel_event_add, read_event_add, write_event_add;
-	clEnqueueWriteBuffer(command_queue, buffer_in, CL_TRUE, 0, sizeof(float) * n, array, NULL, NULL, &write_event_add);
+	cl_event kernel_event_add, read_event_add, write_event_add, unmap_event_add;
+	if (!zero_copy) {
+		clEnqueueWriteBuffer(command_queue, buffer_in, CL_TRUE, 0, sizeof(float) * n, array, NULL, NULL, &write_event_add);
+	}
 	// setting kernel arguments
 	ret = clSetKernelArg(kernel, 0, sizeof(cl_mem), &buffer_in);
 	if (ret != CL_SUCCESS) {
 		cerr << "Kernel argument setting failed";
-		delete[] array;
+		FreeHostArray(array);
 		clReleaseMemObject(buffer_in);
 		clReleaseMemObject(buffer_out);
 		clReleaseKernel(kernel);
@@ -380,7 +402,7 @@ int main(int argc, char* argv[])
 	ret = clSetKernelArg(kernel, 1, sizeof(cl_mem), &buffer_out);
 	if (ret != CL_SUCCESS) {
 		cerr << "Kernel argument setting failed";
-		delete[] array;
+		FreeHostArray(array);
 		clReleaseMemObject(buffer_in);
 		clReleaseMemObject(buffer_out);
 		clReleaseKernel(kernel);
@@ -392,7 +414,7 @@ int main(int argc, char* argv[])
 	ret = clSetKernelArg(kernel, 2, sizeof(cl_int), &global_size);
 	if (ret != CL_SUCCESS) {
 		cerr << "Kernel argument setting failed";
-		delete[] array;
+		FreeHostArray(array);
 		clReleaseMemObject(buffer_in);
 		clReleaseMemObject(buffer_out);
 		clReleaseKernel(kernel);
@@ -404,7 +426,7 @@ int main(int argc, char* argv[])
 	ret = clEnqueueNDRangeKernel(command_queue, kernel, 1, NULL, global_memory_size, local_memory_size, 0, NULL, &kernel_event_add);
 	if (ret != CL_SUCCESS) {
 		cerr << "Adding kernel to queue failed";
-		delete[] array;
+		FreeHostArray(array);
 		clReleaseMemObject(buffer_in);
 		clReleaseMemObject(buffer_out);
 		clReleaseKernel(kernel);
@@ -416,10 +438,19 @@ int main(int argc, char* argv[])
 	// waiting for event to be completed
 	ret = clWaitForEvents(1, &kernel_event_add);
 	// getting result
-	ret = clEnqueueReadBuffer(command_queue, buffer_out, CL_TRUE, 0, sizeof(float) * n, array, 0, NULL, &read_event_add);
+	if (zero_copy) {
+		// mapping buffer_out makes the result visible in array which the buffer works in
+		void* mapped_out = clEnqueueMapBuffer(command_queue, buffer_out, CL_TRUE, CL_MAP_READ, 0, sizeof(float) * n, 0, NULL, &read_event_add, &ret);
+		if (ret == CL_SUCCESS) {
+			ret = clEnqueueUnmapMemObject(command_queue, buffer_out, mapped_out, 0, NULL, &unmap_event_add);
+		}
+	}
+	else {
+		ret = clEnqueueReadBuffer(command_queue, buffer_out, CL_TRUE, 0, sizeof(float) * n, array, 0, NULL, &read_event_add);
+	}
 	if (ret != CL_SUCCESS) {
 		cerr << "Reading result from buffer failed";
-		delete[] array;
+		FreeHostArray(array);
 		clReleaseMemObject(buffer_in);
 		clReleaseMemObject(buffer_out);
 		clReleaseKernel(kernel);
@@ -451,22 +482,39 @@ int main(int argc, char* argv[])
 	clGetEventProfilingInfo(kernel_event_add, CL_PROFILING_COMMAND_END, sizeof(time_end_add), &time_end_add, NULL);
 	kernel_time += time_end_add - time_start_add;
 
-	clGetEventProfilingInfo(write_event, CL_PROFILING_COMMAND_START, sizeof(time_start_2), &time_start_2, NULL);
-	clGetEventProfilingInfo(write_event, CL_PROFILING_COMMAND_END, sizeof(time_end_2), &time_end_2, NULL);
-	double exec_time = time_end_2 - time_start_2;
-	clGetEventProfilingInfo(read_event, CL_PROFILING_COMMAND_START, sizeof(time_start_2), &time_start_2, NULL);
-	clGetEventProfilingInfo(read_event, CL_PROFILING_COMMAND_END, sizeof(time_end_2), &time_end_2, NULL);
-	exec_time += time_end_2 - time_start_2;
-	clGetEventProfilingInfo(write_event_add, CL_PROFILING_COMMAND_START, sizeof(time_start_add_2), &time_start_add_2, NULL);
-	clGetEventProfilingInfo(write_event_add, CL_PROFILING_COMMAND_END, sizeof(time_end_add_2), &time_end_add_2, NULL);
-	exec_time += time_end_add_2 - time_start_add_2;
+	// without copies only mapping and unmapping the result are added to the kernels
+	double exec_time = kernel_time;
+	if (zero_copy) {
+		clGetEventProfilingInfo(unmap_event_add, CL_PROFILING_COMMAND_START, sizeof(time_start_add_2), &time_start_add_2, NULL);
+		clGetEventProfilingInfo(unmap_event_add, CL_PROFILING_COMMAND_END, sizeof(time_end_add_2), &time_end_add_2, NULL);
+		exec_time += time_end_add_2 - time_start_add_2;
+	}
+	else {
+		clGetEventProfilingInfo(write_event, CL_PROFILING_COMMAND_START, sizeof(time_start_2), &time_start_2, NULL);
+		clGetEventProfilingInfo(write_event, CL_PROFILING_COMMAND_END, sizeof(time_end_2), &time_end_2, NULL);
+		exec_time += time_end_2 - time_start_2;
+		clGetEventProfilingInfo(read_event, CL_PROFILING_COMMAND_START, sizeof(time_start_2), &time_start_2, NULL);
+		clGetEventProfilingInfo(read_event, CL_PROFILING_COMMAND_END, sizeof(time_end_2), &time_end_2, NULL);
+		exec_time += time_end_2 - time_start_2;
+		clGetEventProfilingInfo(write_event_add, CL_PROFILING_COMMAND_START, sizeof(time_start_add_2), &time_start_add_2, NULL);
+		clGetEventProfilingInfo(write_event_add, CL_PROFILING_COMMAND_END, sizeof(time_end_add_2), &time_end_add_2, NULL);
+		exec_time += time_end_add_2 - time_start_add_2;
+	}
 	clGetEventProfilingInfo(read_event_add, CL_PROFILING_COMMAND_START, sizeof(time_start_add_2), &time_start_add_2, NULL);
 	clGetEventProfilingInfo(read_event_add, CL_PROFILING_COMMAND_END, sizeof(time_end_add_2), &time_end_add_2, NULL);
-	exec_time += time_end_add_2 - time_start_add_2 + kernel_time;
+	exec_time += time_end_add_2 - time_start_add_2;
 
 	cout << "Time: " << kernel_time / 1000000.0 << "\t" << exec_time / 1000000.0 << "\n";
+	if (zero_copy) {
+		cout << "Zero-copy buffers\n";
+	}
+	cout << "Startup: " << startup_time << (from_cache ? " (cached binary)" : " (built from source)") << "\n";
 	cout << "LOCAL_WORK_SIZE " << local_size << "\n";
 
+	// the buffers have to be released before array which one of them works in
+	clReleaseMemObject(buffer_in);
+	clReleaseMemObject(buffer_out);
+	clReleaseKernel(kernel);
 	clReleaseProgram(program);
 	clReleaseCommandQueue(command_queue);
 	clReleaseContext(context);
@@ -476,7 +524,7 @@ int main(int argc, char* argv[])
 	output.open(file_out);
 	if (!output) {
 		cerr << "Writing file error";
-		delete[] array;
+		FreeHostArray(array);
 		exit(1);
 	}
 	// writing result_matrix to file
@@ -486,7 +534,7 @@ int main(int argc, char* argv[])
 	}
 	output << "\n";
 
-	delete[] array;
+	FreeHostArray(array);
 	output.close();
 
 	return 0;
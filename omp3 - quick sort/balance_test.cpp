@@ -0,0 +1,82 @@
+﻿#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <omp.h>
+
+#include "sort.h"
+
+using namespace std;
+
+//test of the sections and tasks realizations: the ranges of n/2 and n/4 elements are long enough to be partitioned
+//by all the threads, so the comparisons have to be spread over them instead of being made by the thread which got
+//the first part. Comparisons are counted by every thread, none of them may make more than MAX_SHARE of all of them
+
+#define TEST_SIZE 2000000
+#define TEST_THREADS 4
+#define MAX_SHARE 0.5
+
+//counters of the threads which compared anything, a thread keeps its counter between the sorts
+vector<unique_ptr<size_t>> counters;
+thread_local size_t* threadCounter = nullptr;
+
+struct CountingLess {
+    bool operator()(int a, int b) const {
+        if (threadCounter == nullptr) {
+            #pragma omp critical(balance_test_counters)
+            {
+                counters.emplace_back(new size_t(0));
+                threadCounter = counters.back().get();
+            }
+        }
+        (*threadCounter)++;
+        return a < b;
+    }
+};
+
+template <class Sort>
+bool check_balance(const char* name, const vector<int>& source, const Sort& sort_array) {
+
+    vector<int> array = source;
+    for (auto& counter : counters) {
+        *counter = 0;
+    }
+
+    sort_array(array.data(), array.size());
+
+    size_t total = 0, largest = 0;
+    int busyThreads = 0;
+    for (auto& counter : counters) {
+        total += *counter;
+        largest = max(largest, *counter);
+        busyThreads += *counter > 0;
+    }
+    double share = total > 0 ? (double)largest / total : 1.0;
+    bool sorted = is_sorted(array.begin(), array.end());
+    bool passed = sorted and share <= MAX_SHARE;
+
+    cout << name << " : " << total << " comparisons by " << busyThreads << " thread(s), the busiest one made "
+        << share * 100 << "%" << (sorted ? "" : ", not sorted") << (passed ? " passed\n" : " FAILED\n");
+    return passed;
+
+}
+
+int main() {
+
+    mt19937 generator(1);
+    vector<int> source(TEST_SIZE);
+    for (int& value : source) {
+        value = (int)generator();
+    }
+
+    bool passed = check_balance("sections", source, [](int* array, size_t n) {
+        sorting::quick_sort_with_sections(array, n, TEST_THREADS, CountingLess());
+    });
+    passed = check_balance("tasks", source, [](int* array, size_t n) {
+        sorting::quick_sort_with_tasks(array, n, TEST_THREADS, CountingLess());
+    }) and passed;
+
+    return passed ? 0 : 1;
+
+}
\ No newline at end of file
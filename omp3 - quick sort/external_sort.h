@@ -0,0 +1,364 @@
+#pragma once
+
+//out-of-core sorting: the input is cut into chunks that fit the memory budget, every chunk is sorted
+//by one of the in-memory realizations and stored in a temporary file as a run, then all the runs
+//are merged by a parallel k-way merge; input, runs and output are read and written in the background
+
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include "sort.h"
+
+//the merge is split between threads only when it has at least this many elements
+#define PARALLEL_MERGE_SIZE 65536
+
+namespace sorting {
+
+//tournament tree over k sorted sequences: inner nodes keep the loser of their match and the winner
+//is on top, so taking the next element replays only the log k matches on the path of its sequence
+template <class T, class Compare>
+class LoserTree {
+
+public:
+
+    LoserTree(const std::vector<const T*>& from, const std::vector<const T*>& to, const Compare& comp)
+        : pos(from), end(to), comp(comp) {
+
+        leaves = 1;
+        while (leaves < pos.size()) {
+            leaves *= 2;
+        }
+        //missing leaves are empty sequences
+        pos.resize(leaves, nullptr);
+        end.resize(leaves, nullptr);
+        tree.resize(leaves);
+        tree[0] = build(1);
+
+    }
+
+    const T& top() const {
+        return *pos[tree[0]];
+    }
+
+    void pop() {
+
+        size_t winner = tree[0];
+        pos[winner]++;
+        for (size_t node = (winner + leaves) / 2; node > 0; node /= 2) {
+            if (beats(tree[node], winner)) {
+                std::swap(tree[node], winner);
+            }
+        }
+        tree[0] = winner;
+
+    }
+
+private:
+
+    std::vector<const T*> pos;
+    std::vector<const T*> end;
+    std::vector<size_t> tree;
+    size_t leaves;
+    const Compare& comp;
+
+    bool beats(size_t a, size_t b) const {
+
+        if (pos[a] == end[a]) {
+            return false;
+        }
+        if (pos[b] == end[b]) {
+            return true;
+        }
+        return !element_less(comp, *pos[b], *pos[a]);
+
+    }
+
+    //plays the matches of the subtree and returns its winner
+    size_t build(size_t node) {
+
+        if (node >= leaves) {
+            return node - leaves;
+        }
+        size_t left = build(2 * node);
+        size_t right = build(2 * node + 1);
+        if (beats(left, right)) {
+            tree[node] = right;
+            return left;
+        }
+        tree[node] = left;
+        return right;
+
+    }
+
+};
+
+//merges sorted sequences [from[i], to[i]) into output
+template <class T, class Compare>
+void multiway_merge(const std::vector<const T*>& from, const std::vector<const T*>& to, T* output, const Compare& comp) {
+
+    size_t total = 0;
+    for (size_t i = 0; i < from.size(); i++) {
+        total += to[i] - from[i];
+    }
+
+    LoserTree<T, Compare> tree(from, to, comp);
+    for (size_t i = 0; i < total; i++) {
+        output[i] = tree.top();
+        tree.pop();
+    }
+
+}
+
+//the same with thNum threads: sampled keys split every sequence into thNum parts by binary search,
+//part t of all the sequences is merged by its own loser tree straight into its place in output
+template <class T, class Compare>
+void parallel_multiway_merge(const std::vector<const T*>& from, const std::vector<const T*>& to, T* output, int thNum, const Compare& comp) {
+
+    using Key = typename KeyOf<T>::type;
+
+    size_t k = from.size();
+    size_t total = 0;
+    for (size_t i = 0; i < k; i++) {
+        total += to[i] - from[i];
+    }
+
+    if (thNum == 1 or total < PARALLEL_MERGE_SIZE) {
+        multiway_merge(from, to, output, comp);
+        return;
+    }
+
+    std::vector<Key> sample;
+    for (size_t i = 0; i < k; i++) {
+        size_t length = to[i] - from[i];
+        for (int j = 1; length > 0 and j <= SAMPLE_OVERSAMPLING; j++) {
+            sample.push_back(KeyOf<T>::get(from[i][length * j / (SAMPLE_OVERSAMPLING + 1)]));
+        }
+    }
+    sequential_sort(sample.data(), 0, sample.size(), comp);
+
+    //bounds[t] are the starts of part t in all the sequences
+    std::vector<std::vector<const T*>> bounds(thNum + 1, std::vector<const T*>(k));
+    std::vector<size_t> offset(thNum + 1, 0);
+    bounds[0] = from;
+    bounds[thNum] = to;
+    offset[thNum] = total;
+    for (int t = 1; t < thNum; t++) {
+        const Key& splitter = sample[sample.size() * t / thNum];
+        for (size_t i = 0; i < k; i++) {
+            bounds[t][i] = std::lower_bound(from[i], to[i], splitter, [&comp](const T& element, const Key& key) {
+                return comp(KeyOf<T>::get(element), key);
+            });
+            offset[t] += bounds[t][i] - from[i];
+        }
+    }
+
+    #pragma omp parallel for num_threads(thNum) schedule(dynamic, 1)
+    for (int t = 0; t < thNum; t++) {
+        multiway_merge(bounds[t], bounds[t + 1], output + offset[t], comp);
+    }
+
+}
+
+//sorted run in a temporary file, it is read by windows and the next window is read in the background
+template <class T>
+struct Run {
+
+    FILE* file = nullptr;
+    size_t unread = 0;
+    std::vector<T> window;
+    std::vector<T> prefetch;
+    size_t pos = 0;
+    size_t size = 0;
+    std::future<size_t> pending;
+
+    void start_reading() {
+
+        if (unread == 0) {
+            return;
+        }
+        size_t count = std::min(unread, prefetch.size());
+        unread -= count;
+        pending = std::async(std::launch::async, [this, count]() {
+            return fread(prefetch.data(), sizeof(T), count, file);
+        });
+
+    }
+
+    //the window was merged: the prefetched one takes its place, false when the run is over
+    bool refill() {
+
+        if (!pending.valid()) {
+            return false;
+        }
+        size = pending.get();
+        if (size == 0) {
+            std::cerr << "Temporary file reading error";
+            exit(1);
+        }
+        pos = 0;
+        std::swap(window, prefetch);
+        start_reading();
+        return true;
+
+    }
+
+    bool on_disk() const {
+        return pending.valid();
+    }
+
+};
+
+//read(T* chunk, size_t capacity) gives the next at most capacity elements of the input and 0 at its end,
+//sortChunk(T* chunk, size_t size) is the in-memory realization, write(const T* data, size_t count) takes
+//the sorted output in order; memoryBudget bytes are shared by the chunks, the run windows and the output,
+//sortChunk allocates scratchBytes bytes per element of a chunk besides it
+template <class T, class Compare = std::less<typename KeyOf<T>::type>, class Reader, class ChunkSorter, class Writer>
+void external_sort(Reader read, ChunkSorter sortChunk, Writer write, size_t memoryBudget, size_t scratchBytes, int thNum,
+    Compare comp = Compare()) {
+
+    std::vector<FILE*> files;
+    std::vector<size_t> runSizes;
+
+    {
+        //three chunks are kept: one is sorted while the next is read and the previous run is written,
+        //the scratch of the realization sorting the chunk takes the rest of the budget
+        size_t chunkSize = std::max<size_t>(memoryBudget / (3 * sizeof(T) + scratchBytes), 1);
+        std::vector<T> chunk(chunkSize);
+        std::vector<T> nextChunk(chunkSize);
+        std::vector<T> writtenChunk(chunkSize);
+        std::future<void> writing;
+
+        size_t filled = read(chunk.data(), chunkSize);
+        while (filled > 0) {
+            std::future<size_t> reading = std::async(std::launch::async, [&read, &nextChunk, chunkSize]() {
+                return read(nextChunk.data(), chunkSize);
+            });
+
+            sortChunk(chunk.data(), filled);
+            size_t nextFilled = reading.get();
+
+            //the whole input fits one chunk
+            if (files.empty() and nextFilled == 0) {
+                write(chunk.data(), filled);
+                return;
+            }
+
+            //writtenChunk is free for the next chunk after the previous run is written
+            if (writing.valid()) {
+                writing.get();
+            }
+            FILE* file = tmpfile();
+            if (file == nullptr) {
+                std::cerr << "Temporary file creation error";
+                exit(1);
+            }
+            files.push_back(file);
+            runSizes.push_back(filled);
+            writing = std::async(std::launch::async, [file, data = chunk.data(), filled]() {
+                if (fwrite(data, sizeof(T), filled, file) != filled) {
+                    std::cerr << "Temporary file writing error";
+                    exit(1);
+                }
+            });
+
+            //the sorted chunk is being written, the read one is sorted next and the free one takes the chunk after it
+            std::swap(writtenChunk, chunk);
+            std::swap(chunk, nextChunk);
+            filled = nextFilled;
+        }
+        if (writing.valid()) {
+            writing.get();
+        }
+    }
+
+    //empty input
+    if (files.empty()) {
+        return;
+    }
+
+    //every run has a window and a prefetched window, the output is merged into one buffer while the other is written,
+    //each output buffer can take all the windows at once
+    size_t k = files.size();
+    size_t windowSize = std::max<size_t>(memoryBudget / (4 * k * sizeof(T)), 1);
+
+    std::vector<Run<T>> runs(k);
+    for (size_t i = 0; i < k; i++) {
+        rewind(files[i]);
+        runs[i].file = files[i];
+        runs[i].unread = runSizes[i];
+        runs[i].window.resize(windowSize);
+        runs[i].prefetch.resize(windowSize);
+        runs[i].start_reading();
+    }
+
+    std::vector<T> output(k * windowSize);
+    std::vector<T> written(k * windowSize);
+    std::future<void> writing;
+
+    auto less = [&comp](const T& a, const T& b) {
+        return element_less(comp, a, b);
+    };
+
+    while (true) {
+        for (size_t i = 0; i < k; i++) {
+            if (runs[i].pos == runs[i].size) {
+                runs[i].refill();
+            }
+        }
+
+        //an element can be merged now if it is not greater than the last loaded element of every run
+        //which still has something on disk
+        const T* bound = nullptr;
+        for (size_t i = 0; i < k; i++) {
+            if (runs[i].pos < runs[i].size and runs[i].on_disk()) {
+                const T* last = &runs[i].window[runs[i].size - 1];
+                if (bound == nullptr or less(*last, *bound)) {
+                    bound = last;
+                }
+            }
+        }
+
+        std::vector<const T*> from, to;
+        size_t total = 0;
+        for (size_t i = 0; i < k; i++) {
+            if (runs[i].pos < runs[i].size) {
+                const T* begin = runs[i].window.data() + runs[i].pos;
+                const T* end = runs[i].window.data() + runs[i].size;
+                if (bound != nullptr) {
+                    end = std::upper_bound(begin, end, *bound, less);
+                }
+                from.push_back(begin);
+                to.push_back(end);
+                total += end - begin;
+                runs[i].pos += end - begin;
+            }
+        }
+        if (total == 0) {
+            break;
+        }
+
+        parallel_multiway_merge(from, to, output.data(), thNum, comp);
+
+        if (writing.valid()) {
+            writing.get();
+        }
+        std::swap(output, written);
+        writing = std::async(std::launch::async, [&write, data = written.data(), total]() {
+            write(data, total);
+        });
+    }
+    if (writing.valid()) {
+        writing.get();
+    }
+
+    for (size_t i = 0; i < k; i++) {
+        fclose(files[i]);
+    }
+
+}
+
+}
@@ -1,209 +1,132 @@
 ﻿#include <iostream>
 #include <string>
 #include <fstream>
-#include <cmath>
 #include <omp.h>
 #include <stdio.h>
 #include <chrono>
 #include <new>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
 
-using namespace std;
-
-void sort(int* array, int startIdx, int endIdx) {
+#include "sort.h"
+#include "external_sort.h"
+#include "text_io.h"
 
-    if (startIdx < endIdx) {
+using namespace std;
 
-        int right = endIdx;
-        int left = startIdx;
-        int pivot = array[(int)((left + right) / 2)];
+void time_out(chrono::steady_clock::time_point start_time, chrono::steady_clock::time_point end_time, size_t n, int thNum) {
 
-        while (left <= right) {
-            while (array[left] < pivot) {
-                left++;
-            }
-            while (array[right] > pivot) {
-                right--;
-            }
-            if (left <= right) {
-                int tmp = array[left];
-                array[left] = array[right];
-                array[right] = tmp;
-                left++;
-                right--;
-            }
-        }
-
-        int divideIdx = left;
+    auto elapsed_ms = chrono::duration_cast<chrono::milliseconds>(end_time - start_time);
+    cout << "time(" << thNum << " thread(s)) : " << elapsed_ms.count() << " ms\n";
 
-        sort(array, startIdx, divideIdx - 1);
-        sort(array, divideIdx, endIdx);
+    //sorting speed to compare the realizations on arrays of different size
+    double elapsed_s = chrono::duration<double>(end_time - start_time).count();
+    if (elapsed_s > 0) {
+        cout << "throughput : " << (long long)(n / elapsed_s) << " elements/s\n";
     }
 
 }
 
-void sort_with_tasks(int* array, int startIdx, int endIdx, int thNum) {
-
-    if (startIdx < endIdx) {
-
-        int right = endIdx;
-        int left = startIdx;
-        int pivot = array[(int)((left + right) / 2)];
-
-        while (left <= right) {
-            while (array[left] < pivot) {
-                left++;
-            }
-            while (array[right] > pivot) {
-                right--;
-            }
-            if (left <= right) {
-                int tmp = array[left];
-                array[left] = array[right];
-                array[right] = tmp;
-                left++;
-                right--;
-            }
-        }
-
-        int divideIdx = left;
+//time of reading or writing the file
+void stage_out(const char* stage, chrono::steady_clock::time_point start_time, chrono::steady_clock::time_point end_time) {
+    auto elapsed_ms = chrono::duration_cast<chrono::milliseconds>(end_time - start_time);
+    cout << stage << " time : " << elapsed_ms.count() << " ms\n";
+}
 
-        //a way to reduce execution time
-        if ( (endIdx - startIdx) < 1000 ) {
-            if (startIdx < right) {
-                sort_with_tasks(array, startIdx, divideIdx - 1, thNum);
-            }
-            if (left < endIdx) {
-                sort_with_tasks(array, divideIdx, endIdx, thNum);
-            }
-        }
-        else {
-            #pragma omp parallel num_threads(thNum)
-            {
-                #pragma omp task
-                sort_with_tasks(array, startIdx, divideIdx - 1, thNum);
-                #pragma omp task
-                sort_with_tasks(array, divideIdx, endIdx, thNum);
-            }
-        }
-                
+void array_out(int* array, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        cout << array[i] << " ";
     }
-
+    cout << "\n";
 }
 
-void sort_with_sections(int* array, int startIdx, int endIdx, int thNum) {
-
-    if (startIdx < endIdx) {
-
-        int right = endIdx;
-        int left = startIdx;
-        int pivot = array[(int)((left + right) / 2)];
-
-        while (left <= right) {
-            while (array[left] < pivot) {
-                left++;
-            }
-            while (array[right] > pivot) {
-                right--;
-            }
-            if (left <= right) {
-                int tmp = array[left];
-                array[left] = array[right];
-                array[right] = tmp;
-                left++;
-                right--;
-            }
-        }
-
-        int divideIdx = left;
-
-        if ((endIdx - startIdx) < 1000) {
-            if (startIdx < right) {
-                sort_with_sections(array, startIdx, divideIdx - 1, thNum);
-            }
-            if (left < endIdx) {
-                sort_with_sections(array, divideIdx, endIdx, thNum);
-            }
-        }
-        else {
-            #pragma omp parallel num_threads(thNum)
-            {
-                #pragma omp sections
-                {
-                    #pragma omp section
-                    sort_with_sections(array, startIdx, divideIdx - 1, thNum);
-                    #pragma omp section
-                    sort_with_sections(array, divideIdx, endIdx, thNum);
-                }
-            }
-        }
+void sort_array(int* array, size_t n, int realization, int threadsAmount) {
 
+    switch (realization) {
+    case 0:
+        //no OMP
+        sorting::quick_sort(array, n);
+        break;
+    case 1:
+        //OMP sections
+        sorting::quick_sort_with_sections(array, n, threadsAmount);
+        break;
+    case 2:
+        //OMP tasks
+        sorting::quick_sort_with_tasks(array, n, threadsAmount);
+        break;
+    case 3:
+        //radix sort
+        sorting::radix_sort(array, n, threadsAmount);
+        break;
+    case 4:
+        //sample sort
+        sorting::sample_sort(array, n, threadsAmount);
+        break;
+    case 5:
+        //work-stealing pool
+        sorting::quick_sort_with_stealing(array, n, threadsAmount);
+        break;
+    case 6:
+        //natural runs
+        sorting::adaptive_sort(array, n, threadsAmount);
+        break;
+    case 7:
+        //stable merge sort
+        sorting::merge_sort(array, n, threadsAmount);
+        break;
     }
 
 }
 
-int* quick_sort(int* array, size_t n) {
-
-    auto start_time = chrono::steady_clock::now();
-
-    sort(array, 0, n - 1);
-
-    auto end_time = chrono::steady_clock::now();
-
-    auto elapsed_ms = chrono::duration_cast<chrono::milliseconds>(end_time - start_time);
-    cout << "time(1 thread(s)) : " << elapsed_ms.count() << " ms\n";
-
-    return array;
-
+//whole text is a non-negative number, false otherwise
+bool parse_count(const string& text, size_t& value) {
+    if (text.empty() or text.find_first_not_of("0123456789") != string::npos) {
+        return false;
+    }
+    try {
+        value = stoull(text);
+    }
+    catch (const out_of_range&) {
+        return false;
+    }
+    return true;
 }
 
-int* quick_sort_with_tasks(int* array, size_t n, int thNum) {
-
-    auto start_time = chrono::steady_clock::now();
-    
-    #pragma omp parallel num_threads(thNum)
-    {
-        #pragma omp single
-        sort_with_tasks(array, 0, n - 1, thNum);
+//whole text is a number from 0 to 1, false otherwise
+bool parse_fraction(const string& text, double& value) {
+    size_t used = 0;
+    try {
+        value = stod(text, &used);
     }
-
-    auto end_time = chrono::steady_clock::now();
-
-    auto elapsed_ms = chrono::duration_cast<chrono::milliseconds>(end_time - start_time);
-    cout << "time(" << thNum << " thread(s)) : " << elapsed_ms.count() << " ms\n";
-
-    return array;
-
+    catch (const logic_error&) {
+        return false;
+    }
+    return used == text.size() and value >= 0 and value <= 1;
 }
 
-int* quick_sort_with_sections(int* array, size_t n, int thNum) {
-
-    auto start_time = chrono::steady_clock::now();
+//bytes per element the realization allocates besides the array: a copy of it for radix, merge and adaptive sort,
+//a copy and a bucket index for sample sort, quick sorts work in place
+size_t sort_scratch(int realization) {
 
-    #pragma omp parallel num_threads(thNum)
-    {
-        #pragma omp single
-        sort_with_sections(array, 0, n - 1, thNum);
+    switch (realization) {
+    case 3:
+    case 6:
+    case 7:
+        return sizeof(int);
+    case 4:
+        return sizeof(int) + sizeof(unsigned short);
+    default:
+        return 0;
     }
 
-    auto end_time = chrono::steady_clock::now();
-
-    auto elapsed_ms = chrono::duration_cast<chrono::milliseconds>(end_time - start_time);
-    cout << "time(" << thNum << " thread(s)) : " << elapsed_ms.count() << " ms\n";
-
-    return array;
-
-}
-
-void array_out(int* array, size_t n) {
-    for (int i = 0; i < n; i++) {
-        cout << array[i] << " ";
-    }
-    cout << "\n";
 }
 
 int main(int argc, char* argv[]) {
 
-    if (argc != 5) {
+    if (argc < 5 or argc > 6) {
         cerr << "Wrong number of parameters";
         exit(1);
     }
@@ -216,13 +139,63 @@ int main(int argc, char* argv[]) {
     // 0 - without multithreading
     // 1 - with OMP sections (threadsAmount >= 0)
     // 2 - with OMP tasks (threadsAmount >= 0)
+    // 3 - LSD radix sort (threadsAmount >= 0)
+    // 4 - sample sort (threadsAmount >= 0)
+    // 5 - with the work-stealing pool (threadsAmount >= 0)
+    // 6 - adaptive: merging of natural runs (threadsAmount >= 0)
+    // 7 - stable merge sort (threadsAmount >= 0)
+    // optional parameter:
+    // <number> - memory budget in MB, a bigger array is sorted out of core by runs of the chosen realization
+    // k=<number> - only the k smallest elements are found and written (sorted)
+    // q=<fraction>,<fraction>,... - only the elements of these quantiles (from 0 to 1) are found and written
+    size_t memoryBudget = 0;
+    size_t topK = 0;
+    vector<double> quantiles;
+    if (argc == 6) {
+        string option = argv[5];
+        if (option.compare(0, 2, "k=") == 0) {
+            if (!parse_count(option.substr(2), topK) or topK == 0) {
+                cerr << "k should be a positive number";
+                exit(1);
+            }
+        }
+        else if (option.compare(0, 2, "q=") == 0) {
+            size_t pos = 2;
+            while (pos <= option.size()) {
+                size_t comma = option.find(',', pos);
+                if (comma == string::npos)
+                    comma = option.size();
+                double q;
+                if (!parse_fraction(option.substr(pos, comma - pos), q)) {
+                    cerr << "Wrong quantile \"" << option.substr(pos, comma - pos) << "\"";
+                    exit(1);
+                }
+                quantiles.push_back(q);
+                pos = comma + 1;
+            }
+        }
+        else {
+            if (!parse_count(option, memoryBudget) or memoryBudget > SIZE_MAX / (1024 * 1024)) {
+                cerr << "Wrong memory budget " << option;
+                exit(1);
+            }
+            memoryBudget *= 1024 * 1024;
+        }
+    }
+
+    if ((realization < 0) or (realization > 7)) {
+        cerr << "No " << realization << " realization. Choose 0, 1, 2, 3, 4, 5, 6 or 7";
+        exit(1);
+    }
 
     if (threadsAmount > omp_get_max_threads() or threadsAmount == 0)
         threadsAmount = omp_get_max_threads();
+    if (realization == 0)
+        threadsAmount = 1;
 
     //opening input file
     ifstream input;
-    input.open(nameIn);
+    input.open(nameIn, ios::binary);
     if (!input) {
         cerr << "Reading file error";
         exit(1);
@@ -232,7 +205,60 @@ int main(int argc, char* argv[]) {
     size_t n;
     input >> n;
 
+    if (memoryBudget > 0 and n * sizeof(int) > memoryBudget) {
+        //the read block takes a part of the budget and the block formatted for writing takes its fixed size,
+        //the rest is left for the chunks, the scratch of the realization and the merge
+        size_t readBlock = max(min(memoryBudget / 16, (size_t)READ_BLOCK), (size_t)MIN_READ_BLOCK);
+        size_t ioBytes = readBlock + (size_t)FORMAT_BLOCK * MAX_NUMBER_CHARS;
+        if (memoryBudget <= ioBytes) {
+            cerr << "Memory budget is too small";
+            exit(1);
+        }
+
+        //opening output file
+        ofstream output;
+        output.open(nameOut);
+        if (!output) {
+            cerr << "Writing file error";
+            exit(1);
+        }
+
+        size_t unread = n;
+        text_io::NumberReader reader(input, readBlock);
+        auto read_chunk = [&reader, &unread](int* chunk, size_t capacity) {
+            size_t count = reader.read(chunk, min(capacity, unread));
+            unread -= count;
+            return count;
+        };
+        auto sort_chunk = [realization, threadsAmount](int* chunk, size_t size) {
+            sort_array(chunk, size, realization, threadsAmount);
+        };
+        //blocks are written in the background while the next one is merged, so they are formatted by one thread
+        auto write_block = [&output](const int* block, size_t count) {
+            text_io::write_numbers(output, block, count, 1);
+        };
+
+        //reading, writing and the temporary runs overlap with the sorting here, so only the total time is known
+        auto start_time = chrono::steady_clock::now();
+        sorting::external_sort<int>(read_chunk, sort_chunk, write_block, memoryBudget - ioBytes, sort_scratch(realization), threadsAmount);
+        auto end_time = chrono::steady_clock::now();
+
+        time_out(start_time, end_time, n, threadsAmount);
+
+        output << "\n";
+        if (!output) {
+            cerr << "Writing file error";
+            exit(1);
+        }
+        input.close();
+        output.close();
+
+        return 0;
+    }
+
     //reading array from file
+    auto read_start_time = chrono::steady_clock::now();
+
     int* array = new (nothrow) int[n];
 
     if (array == nullptr) {
@@ -240,33 +266,76 @@ int main(int argc, char* argv[]) {
         exit(1);
     }
 
-    for (int i = 0; i < n; i++) {
-        input >> array[i];
+    //the rest of the file is read at once and parsed by all threads
+    streamoff textStart = input.tellg();
+    input.seekg(0, ios::end);
+    size_t textSize = (size_t)(input.tellg() - textStart);
+    input.seekg(textStart);
+
+    char* text = new (nothrow) char[textSize];
+
+    if (text == nullptr) {
+        cerr << "Memory can not be allocated";
+        delete[] array;
+        exit(1);
     }
 
+    input.read(text, textSize);
     input.close();
 
+    size_t found = text_io::parse_numbers(text, text + textSize, array, n, threadsAmount);
+    delete[] text;
+
+    if (found < n) {
+        cerr << "Reading file error";
+        delete[] array;
+        exit(1);
+    }
+
+    auto read_end_time = chrono::steady_clock::now();
+
+    stage_out("read", read_start_time, read_end_time);
+
     //array_out(array, n);
 
-    switch (realization) {
-    case 0:
-        //no OMP
-        array = quick_sort(array, n);
-        //array_out(array, n);
-        break;
-    case 1:
-        //OMP sections
-        array = quick_sort_with_sections(array, n, threadsAmount);
-        break;
-    case 2:
-        //OMP tasks
-        array = quick_sort_with_tasks(array, n, threadsAmount);
-        break;
-    default:
-        cerr << "No " << realization << " realization. Choose 0, 1 or 2";
+    //written part of the array
+    int* result = array;
+    size_t resultSize = n;
+    vector<int> selected;
+
+    auto start_time = chrono::steady_clock::now();
+
+    if (topK > 0) {
+        //selection of the k smallest elements
+        sorting::top_k(array, n, topK, threadsAmount);
+        resultSize = min(topK, n);
+    }
+    else if (!quantiles.empty() and n > 0) {
+        //selection of the quantiles, the rank of quantile q is the nearest to q * (n - 1)
+        vector<size_t> ranks;
+        for (double q : quantiles) {
+            ranks.push_back((size_t)llround(q * (n - 1)));
+        }
+        sorting::multi_select(array, n, ranks, threadsAmount);
+
+        sort(ranks.begin(), ranks.end());
+        for (size_t rank : ranks) {
+            selected.push_back(array[rank]);
+        }
+        result = selected.data();
+        resultSize = selected.size();
+    }
+    else {
+        sort_array(array, n, realization, threadsAmount);
     }
 
+    auto end_time = chrono::steady_clock::now();
+
+    time_out(start_time, end_time, n, threadsAmount);
+
     //opening output file
+    auto write_start_time = chrono::steady_clock::now();
+
     ofstream output;
     output.open(nameOut);
     if (!output) {
@@ -276,10 +345,18 @@ int main(int argc, char* argv[]) {
     }
 
     //writing result to file
-    for (int i = 0; i < n; i++) {
-        output << array[i] << " ";
-    }
+    text_io::write_numbers(output, result, resultSize, threadsAmount);
     output << "\n";
+    output.flush();
+    if (!output) {
+        cerr << "Writing file error";
+        delete[] array;
+        exit(1);
+    }
+
+    auto write_end_time = chrono::steady_clock::now();
+
+    stage_out("write", write_start_time, write_end_time);
 
     //deleting array from memory
     delete[] array;
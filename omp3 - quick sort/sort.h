@@ -0,0 +1,1605 @@
+#pragma once
+
+//header-only sort engine: every realization is a template over the element type and a key comparator.
+//An element is either a key itself or a Record carrying a payload next to its key,
+//ranges are given as half-open index intervals array[startIdx, endIdx)
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <iostream>
+#include <new>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <type_traits>
+#include <omp.h>
+
+#include "../common/work_stealing.h"
+
+//vectorized partition kernels are built on x86 only, "-D SIMD_PARTITION=0" leaves just the scalar one
+#ifndef SIMD_PARTITION
+#if defined(__x86_64__) or defined(_M_X64) or defined(__i386__) or defined(_M_IX86)
+#define SIMD_PARTITION 1
+#else
+#define SIMD_PARTITION 0
+#endif
+#endif
+
+#if SIMD_PARTITION
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_AVX2
+#define TARGET_AVX512
+#define POPCOUNT(x) __popcnt(x)
+#else
+#define TARGET_AVX2 __attribute__((target("avx2,popcnt")))
+#define TARGET_AVX512 __attribute__((target("avx512f,popcnt")))
+#define POPCOUNT(x) __builtin_popcount(x)
+#endif
+#endif
+
+//quick sort ranges shorter than this are finished by insertion sort
+#define INSERTION_SORT_SIZE 24
+//ranges longer than this take a ninther as the pivot
+#define NINTHER_SIZE 128
+//block partitioning classifies this many elements from each side at once (offsets fit in a byte)
+#define PARTITION_BLOCK 64
+//ranges at least this long are partitioned by the vectorized kernel when the CPU has one
+#define SIMD_PARTITION_SIZE 64
+//ranges shorter than this are sorted by one thread without creating tasks or sections
+#define TASK_SIZE 1000
+//ranges longer than this are partitioned by all threads together
+#define PARALLEL_PARTITION_SIZE 100000
+//sample sort takes this many random elements per bucket to choose splitters
+#define SAMPLE_OVERSAMPLING 32
+//radix sort handles keys by digits of RADIX_BITS bits
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+//radix sort gathers a cache line of elements per digit (at least 4 of them) before writing them out
+#define RADIX_BUFFER_BYTES 64
+//natural runs shorter than this are sorted together with their short neighbours instead of being merged
+#define MIN_RUN_SIZE 64
+//places checked for a run of MIN_RUN_SIZE before the whole array is scanned for runs
+#define RUN_PROBES 64
+//parallel merges are cut into pieces of about this many elements
+#define MERGE_PIECE_SIZE 8192
+//merge sort sorts blocks of this many bytes by one thread each, a block and its part of the buffer stay in L2 cache
+#define MERGE_SORT_BLOCK_BYTES 65536
+
+namespace sorting {
+
+//element which carries its payload next to the key, so sorting by key moves the whole record
+template <class Key, class Payload>
+struct Record {
+    Key key;
+    Payload payload;
+};
+
+template <class T>
+struct KeyOf {
+    using type = T;
+    static const T& get(const T& element) {
+        return element;
+    }
+};
+
+template <class Key, class Payload>
+struct KeyOf<Record<Key, Payload>> {
+    using type = Key;
+    static const Key& get(const Record<Key, Payload>& element) {
+        return element.key;
+    }
+};
+
+template <class T, class Compare>
+inline bool element_less(const Compare& comp, const T& a, const T& b) {
+    return comp(KeyOf<T>::get(a), KeyOf<T>::get(b));
+}
+
+template <class T, class Compare>
+void insertion_sort(T* array, size_t startIdx, size_t endIdx, const Compare& comp) {
+
+    for (size_t i = startIdx + 1; i < endIdx; i++) {
+        T value = std::move(array[i]);
+        size_t j = i;
+        while (j > startIdx and element_less(comp, value, array[j - 1])) {
+            array[j] = std::move(array[j - 1]);
+            j--;
+        }
+        array[j] = std::move(value);
+    }
+
+}
+
+//restores the heap of size elements below the root
+template <class T, class Compare>
+void sift_down(T* heap, size_t size, size_t root, const Compare& comp) {
+
+    T value = std::move(heap[root]);
+
+    while (2 * root + 1 < size) {
+        size_t child = 2 * root + 1;
+        if (child + 1 < size and element_less(comp, heap[child], heap[child + 1])) {
+            child++;
+        }
+        if (!element_less(comp, value, heap[child])) {
+            break;
+        }
+        heap[root] = std::move(heap[child]);
+        root = child;
+    }
+    heap[root] = std::move(value);
+
+}
+
+template <class T, class Compare>
+void heap_sort(T* array, size_t startIdx, size_t endIdx, const Compare& comp) {
+
+    T* heap = array + startIdx;
+    size_t size = endIdx - startIdx;
+    for (size_t root = size / 2; root > 0; root--) {
+        sift_down(heap, size, root - 1, comp);
+    }
+    for (size_t last = size - 1; last > 0; last--) {
+        std::swap(heap[0], heap[last]);
+        sift_down(heap, last, 0, comp);
+    }
+
+}
+
+//orders three elements so that array[a] <= array[b] <= array[c]
+template <class T, class Compare>
+void sort3(T* array, size_t a, size_t b, size_t c, const Compare& comp) {
+
+    if (element_less(comp, array[b], array[a])) {
+        std::swap(array[a], array[b]);
+    }
+    if (element_less(comp, array[c], array[b])) {
+        std::swap(array[b], array[c]);
+        if (element_less(comp, array[b], array[a])) {
+            std::swap(array[a], array[b]);
+        }
+    }
+
+}
+
+//puts the pivot to array[startIdx]: a median of three for short ranges
+//and a ninther (median of three medians) for long ones, the range has at least 3 elements
+template <class T, class Compare>
+void choose_pivot(T* array, size_t startIdx, size_t endIdx, const Compare& comp) {
+
+    size_t middle = startIdx + (endIdx - startIdx) / 2;
+    size_t last = endIdx - 1;
+
+    if (endIdx - startIdx > NINTHER_SIZE) {
+        sort3(array, startIdx, middle, last, comp);
+        sort3(array, startIdx + 1, middle - 1, last - 1, comp);
+        sort3(array, startIdx + 2, middle + 1, last - 2, comp);
+        sort3(array, middle - 1, middle, middle + 1, comp);
+        std::swap(array[startIdx], array[middle]);
+    }
+    else {
+        sort3(array, middle, startIdx, last, comp);
+    }
+
+}
+
+//scalar kernel of block_partition:
+//while the range is long, elements are classified by blocks into offset arrays without branches
+//and only then swapped, so random data does not cause branch mispredictions
+template <bool OrEqual, class T, class Compare>
+size_t block_partition_scalar(T* array, size_t startIdx, size_t endIdx, const T& pivot, const Compare& comp) {
+
+    auto goesLeft = [&pivot, &comp](const T& value) {
+        if constexpr (OrEqual) {
+            return !element_less(comp, pivot, value);
+        }
+        else {
+            return element_less(comp, value, pivot);
+        }
+    };
+
+    size_t left = startIdx;
+    size_t right = endIdx;
+
+    unsigned char offsetsLeft[PARTITION_BLOCK];
+    unsigned char offsetsRight[PARTITION_BLOCK];
+    int numLeft = 0, numRight = 0;
+    int firstLeft = 0, firstRight = 0;
+
+    //everything before left goes left, everything from right on goes right
+    while (right - left > 2 * PARTITION_BLOCK) {
+        if (numLeft == 0) {
+            firstLeft = 0;
+            for (int i = 0; i < PARTITION_BLOCK; i++) {
+                offsetsLeft[numLeft] = (unsigned char)i;
+                numLeft += !goesLeft(array[left + i]);
+            }
+        }
+        if (numRight == 0) {
+            firstRight = 0;
+            for (int i = 0; i < PARTITION_BLOCK; i++) {
+                offsetsRight[numRight] = (unsigned char)i;
+                numRight += goesLeft(array[right - 1 - i]);
+            }
+        }
+
+        int num = std::min(numLeft, numRight);
+        for (int i = 0; i < num; i++) {
+            std::swap(array[left + offsetsLeft[firstLeft + i]], array[right - 1 - offsetsRight[firstRight + i]]);
+        }
+        numLeft -= num;
+        numRight -= num;
+        firstLeft += num;
+        firstRight += num;
+
+        if (numLeft == 0) {
+            left += PARTITION_BLOCK;
+        }
+        if (numRight == 0) {
+            right -= PARTITION_BLOCK;
+        }
+    }
+
+    //the rest is shorter than two blocks
+    while (true) {
+        while (left < right and goesLeft(array[left])) {
+            left++;
+        }
+        while (left < right and !goesLeft(array[right - 1])) {
+            right--;
+        }
+        if (left >= right) {
+            break;
+        }
+        std::swap(array[left], array[right - 1]);
+        left++;
+        right--;
+    }
+
+    return left;
+
+}
+
+#if SIMD_PARTITION
+
+enum SimdLevel { SIMD_NONE, SIMD_AVX2, SIMD_AVX512 };
+
+inline SimdLevel detect_simd() {
+
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return SIMD_NONE;
+    }
+    //the OS has to save the wide registers too
+    __cpuid(info, 1);
+    if (!((info[2] >> 27) & 1)) {
+        return SIMD_NONE;
+    }
+    unsigned long long xcr0 = _xgetbv(0);
+    __cpuidex(info, 7, 0);
+    if (((info[1] >> 16) & 1) and (xcr0 & 0xE6) == 0xE6) {
+        return SIMD_AVX512;
+    }
+    if (((info[1] >> 5) & 1) and (xcr0 & 0x6) == 0x6) {
+        return SIMD_AVX2;
+    }
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return SIMD_AVX512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return SIMD_AVX2;
+    }
+#endif
+    return SIMD_NONE;
+
+}
+
+inline SimdLevel simd_level() {
+    static const SimdLevel level = detect_simd();
+    return level;
+}
+
+//lane orders for the AVX2 kernels: for every comparison mask the lanes with set bits go first;
+//64-bit keys are permuted as pairs of 32-bit lanes
+struct PermutationTable {
+    alignas(32) int lanes8[256][8];
+    alignas(32) int lanes4[16][8];
+    PermutationTable() {
+        for (int mask = 0; mask < 256; mask++) {
+            int lane = 0;
+            for (int i = 0; i < 8; i++) {
+                if ((mask >> i) & 1) {
+                    lanes8[mask][lane++] = i;
+                }
+            }
+            for (int i = 0; i < 8; i++) {
+                if (!((mask >> i) & 1)) {
+                    lanes8[mask][lane++] = i;
+                }
+            }
+        }
+        for (int mask = 0; mask < 16; mask++) {
+            int lane = 0;
+            for (int pass = 1; pass >= 0; pass--) {
+                for (int i = 0; i < 4; i++) {
+                    if (((mask >> i) & 1) == pass) {
+                        lanes4[mask][lane++] = 2 * i;
+                        lanes4[mask][lane++] = 2 * i + 1;
+                    }
+                }
+            }
+        }
+    }
+};
+
+inline const PermutationTable permutationTable;
+
+//vector operations of the kernels for every key type which has them
+template <class Key> struct Avx512;
+template <class Key> struct Avx2;
+
+template <> struct Avx512<int> {
+    using Vector = __m512i;
+    static const int width = 16;
+    TARGET_AVX512 static Vector load(const int* p) { return _mm512_loadu_si512(p); }
+    TARGET_AVX512 static void store(int* p, Vector v) { _mm512_storeu_si512(p, v); }
+    TARGET_AVX512 static Vector set(int key) { return _mm512_set1_epi32(key); }
+    template <bool OrEqual>
+    TARGET_AVX512 static unsigned int less(Vector v, Vector pivots) {
+        return OrEqual ? _mm512_cmple_epi32_mask(v, pivots) : _mm512_cmplt_epi32_mask(v, pivots);
+    }
+    TARGET_AVX512 static void compress(int* p, unsigned int mask, Vector v) { _mm512_mask_compressstoreu_epi32(p, (__mmask16)mask, v); }
+};
+
+template <> struct Avx512<float> {
+    using Vector = __m512;
+    static const int width = 16;
+    TARGET_AVX512 static Vector load(const float* p) { return _mm512_loadu_ps(p); }
+    TARGET_AVX512 static void store(float* p, Vector v) { _mm512_storeu_ps(p, v); }
+    TARGET_AVX512 static Vector set(float key) { return _mm512_set1_ps(key); }
+    template <bool OrEqual>
+    TARGET_AVX512 static unsigned int less(Vector v, Vector pivots) {
+        return OrEqual ? _mm512_cmp_ps_mask(v, pivots, _CMP_LE_OQ) : _mm512_cmp_ps_mask(v, pivots, _CMP_LT_OQ);
+    }
+    TARGET_AVX512 static void compress(float* p, unsigned int mask, Vector v) { _mm512_mask_compressstoreu_ps(p, (__mmask16)mask, v); }
+};
+
+template <> struct Avx512<double> {
+    using Vector = __m512d;
+    static const int width = 8;
+    TARGET_AVX512 static Vector load(const double* p) { return _mm512_loadu_pd(p); }
+    TARGET_AVX512 static void store(double* p, Vector v) { _mm512_storeu_pd(p, v); }
+    TARGET_AVX512 static Vector set(double key) { return _mm512_set1_pd(key); }
+    template <bool OrEqual>
+    TARGET_AVX512 static unsigned int less(Vector v, Vector pivots) {
+        return OrEqual ? _mm512_cmp_pd_mask(v, pivots, _CMP_LE_OQ) : _mm512_cmp_pd_mask(v, pivots, _CMP_LT_OQ);
+    }
+    TARGET_AVX512 static void compress(double* p, unsigned int mask, Vector v) { _mm512_mask_compressstoreu_pd(p, (__mmask8)mask, v); }
+};
+
+template <> struct Avx512<std::uint64_t> {
+    using Vector = __m512i;
+    static const int width = 8;
+    TARGET_AVX512 static Vector load(const std::uint64_t* p) { return _mm512_loadu_si512(p); }
+    TARGET_AVX512 static void store(std::uint64_t* p, Vector v) { _mm512_storeu_si512(p, v); }
+    TARGET_AVX512 static Vector set(std::uint64_t key) { return _mm512_set1_epi64((long long)key); }
+    template <bool OrEqual>
+    TARGET_AVX512 static unsigned int less(Vector v, Vector pivots) {
+        return OrEqual ? _mm512_cmple_epu64_mask(v, pivots) : _mm512_cmplt_epu64_mask(v, pivots);
+    }
+    TARGET_AVX512 static void compress(std::uint64_t* p, unsigned int mask, Vector v) { _mm512_mask_compressstoreu_epi64(p, (__mmask8)mask, v); }
+};
+
+//AVX2 has no compress, so the lanes are permuted to put the lesser ones first
+template <> struct Avx2<int> {
+    using Vector = __m256i;
+    static const int width = 8;
+    TARGET_AVX2 static Vector load(const int* p) { return _mm256_loadu_si256((const __m256i*)p); }
+    TARGET_AVX2 static void store(int* p, Vector v) { _mm256_storeu_si256((__m256i*)p, v); }
+    TARGET_AVX2 static Vector set(int key) { return _mm256_set1_epi32(key); }
+    template <bool OrEqual>
+    TARGET_AVX2 static unsigned int less(Vector v, Vector pivots) {
+        if (OrEqual) {
+            return ~_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(v, pivots))) & 0xFF;
+        }
+        return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(pivots, v)));
+    }
+    TARGET_AVX2 static Vector permute(Vector v, unsigned int mask) {
+        return _mm256_permutevar8x32_epi32(v, _mm256_load_si256((const __m256i*)permutationTable.lanes8[mask]));
+    }
+};
+
+template <> struct Avx2<float> {
+    using Vector = __m256;
+    static const int width = 8;
+    TARGET_AVX2 static Vector load(const float* p) { return _mm256_loadu_ps(p); }
+    TARGET_AVX2 static void store(float* p, Vector v) { _mm256_storeu_ps(p, v); }
+    TARGET_AVX2 static Vector set(float key) { return _mm256_set1_ps(key); }
+    template <bool OrEqual>
+    TARGET_AVX2 static unsigned int less(Vector v, Vector pivots) {
+        return _mm256_movemask_ps(_mm256_cmp_ps(v, pivots, OrEqual ? _CMP_LE_OQ : _CMP_LT_OQ));
+    }
+    TARGET_AVX2 static Vector permute(Vector v, unsigned int mask) {
+        return _mm256_permutevar8x32_ps(v, _mm256_load_si256((const __m256i*)permutationTable.lanes8[mask]));
+    }
+};
+
+template <> struct Avx2<double> {
+    using Vector = __m256d;
+    static const int width = 4;
+    TARGET_AVX2 static Vector load(const double* p) { return _mm256_loadu_pd(p); }
+    TARGET_AVX2 static void store(double* p, Vector v) { _mm256_storeu_pd(p, v); }
+    TARGET_AVX2 static Vector set(double key) { return _mm256_set1_pd(key); }
+    template <bool OrEqual>
+    TARGET_AVX2 static unsigned int less(Vector v, Vector pivots) {
+        return _mm256_movemask_pd(_mm256_cmp_pd(v, pivots, OrEqual ? _CMP_LE_OQ : _CMP_LT_OQ));
+    }
+    TARGET_AVX2 static Vector permute(Vector v, unsigned int mask) {
+        __m256i lanes = _mm256_load_si256((const __m256i*)permutationTable.lanes4[mask]);
+        return _mm256_castps_pd(_mm256_permutevar8x32_ps(_mm256_castpd_ps(v), lanes));
+    }
+};
+
+template <> struct Avx2<std::uint64_t> {
+    using Vector = __m256i;
+    static const int width = 4;
+    TARGET_AVX2 static Vector load(const std::uint64_t* p) { return _mm256_loadu_si256((const __m256i*)p); }
+    TARGET_AVX2 static void store(std::uint64_t* p, Vector v) { _mm256_storeu_si256((__m256i*)p, v); }
+    TARGET_AVX2 static Vector set(std::uint64_t key) { return _mm256_set1_epi64x((long long)key); }
+    //there is only a signed comparison, so the sign bits are flipped first
+    template <bool OrEqual>
+    TARGET_AVX2 static unsigned int less(Vector v, Vector pivots) {
+        __m256i sign = _mm256_set1_epi64x((long long)0x8000000000000000ull);
+        __m256i a = _mm256_xor_si256(v, sign);
+        __m256i b = _mm256_xor_si256(pivots, sign);
+        if (OrEqual) {
+            return ~_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(a, b))) & 0xF;
+        }
+        return _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(b, a)));
+    }
+    TARGET_AVX2 static Vector permute(Vector v, unsigned int mask) {
+        return _mm256_permutevar8x32_epi32(v, _mm256_load_si256((const __m256i*)permutationTable.lanes4[mask]));
+    }
+};
+
+//plain key arrays sorted in the natural order go to the vectorized kernels
+template <class T, class Compare> struct SimdPartition : std::false_type {};
+template <> struct SimdPartition<int, std::less<int>> : std::true_type {};
+template <> struct SimdPartition<float, std::less<float>> : std::true_type {};
+template <> struct SimdPartition<double, std::less<double>> : std::true_type {};
+template <> struct SimdPartition<std::uint64_t, std::less<std::uint64_t>> : std::true_type {};
+
+//puts the elements which are left after the vector loop into the free space between writeLeft and writeRight,
+//both ends are written every time and only one pointer moves, so there are no branches
+template <bool OrEqual, class Key>
+void finish_partition(const Key* rest, size_t restCount, Key*& writeLeft, Key*& writeRight, Key pivot) {
+
+    for (size_t i = 0; i < restCount; i++) {
+        Key value = rest[i];
+        bool goesLeft = OrEqual ? !(pivot < value) : (value < pivot);
+        *writeLeft = value;
+        *(writeRight - 1) = value;
+        writeLeft += goesLeft;
+        writeRight -= !goesLeft;
+    }
+
+}
+
+//vectorized kernels of block_partition for ranges of at least two vectors:
+//the first and the last vectors are saved in registers, which leaves a vector of free space at both ends;
+//every next vector is read from the side with less free space, compared with the pivot at once
+//and its parts are stored to the left and the right free space
+template <bool OrEqual, class Key>
+TARGET_AVX512 size_t block_partition_avx512(Key* array, size_t startIdx, size_t endIdx, Key pivot) {
+
+    using Simd = Avx512<Key>;
+    const size_t width = Simd::width;
+    typename Simd::Vector pivots = Simd::set(pivot);
+
+    Key* writeLeft = array + startIdx;
+    Key* writeRight = array + endIdx;
+    Key* readLeft = writeLeft + width;
+    Key* readRight = writeRight - width;
+    typename Simd::Vector first = Simd::load(writeLeft);
+    typename Simd::Vector last = Simd::load(readRight);
+
+    while ((size_t)(readRight - readLeft) >= width) {
+        typename Simd::Vector values;
+        if (readLeft - writeLeft <= writeRight - readRight) {
+            values = Simd::load(readLeft);
+            readLeft += width;
+        }
+        else {
+            readRight -= width;
+            values = Simd::load(readRight);
+        }
+
+        unsigned int less = Simd::template less<OrEqual>(values, pivots);
+        size_t count = POPCOUNT(less);
+        Simd::compress(writeLeft, less, values);
+        writeLeft += count;
+        writeRight -= width - count;
+        Simd::compress(writeRight, ~less, values);
+    }
+
+    Key rest[3 * Simd::width];
+    size_t restCount = readRight - readLeft;
+    std::copy(readLeft, readRight, rest);
+    Simd::store(rest + restCount, first);
+    Simd::store(rest + restCount + width, last);
+    finish_partition<OrEqual>(rest, restCount + 2 * width, writeLeft, writeRight, pivot);
+
+    return writeLeft - array;
+
+}
+
+//the same with AVX2: the permuted vector is stored whole at both ends, the extra lanes fall into the free space
+template <bool OrEqual, class Key>
+TARGET_AVX2 size_t block_partition_avx2(Key* array, size_t startIdx, size_t endIdx, Key pivot) {
+
+    using Simd = Avx2<Key>;
+    const size_t width = Simd::width;
+    typename Simd::Vector pivots = Simd::set(pivot);
+
+    Key* writeLeft = array + startIdx;
+    Key* writeRight = array + endIdx;
+    Key* readLeft = writeLeft + width;
+    Key* readRight = writeRight - width;
+    typename Simd::Vector first = Simd::load(writeLeft);
+    typename Simd::Vector last = Simd::load(readRight);
+
+    while ((size_t)(readRight - readLeft) >= width) {
+        typename Simd::Vector values;
+        if (readLeft - writeLeft <= writeRight - readRight) {
+            values = Simd::load(readLeft);
+            readLeft += width;
+        }
+        else {
+            readRight -= width;
+            values = Simd::load(readRight);
+        }
+
+        unsigned int less = Simd::template less<OrEqual>(values, pivots);
+        size_t count = POPCOUNT(less);
+        typename Simd::Vector ordered = Simd::permute(values, less);
+        Simd::store(writeLeft, ordered);
+        Simd::store(writeRight - width, ordered);
+        writeLeft += count;
+        writeRight -= width - count;
+    }
+
+    Key rest[3 * Simd::width];
+    size_t restCount = readRight - readLeft;
+    std::copy(readLeft, readRight, rest);
+    Simd::store(rest + restCount, first);
+    Simd::store(rest + restCount + width, last);
+    finish_partition<OrEqual>(rest, restCount + 2 * width, writeLeft, writeRight, pivot);
+
+    return writeLeft - array;
+
+}
+
+#endif
+
+//moves the elements that are less than pivot (or not greater than it for OrEqual) to the beginning
+//of array[startIdx, endIdx) and returns the index of the first element of the rest;
+//long ranges of keys with a vectorized kernel go to the widest one the CPU supports
+template <bool OrEqual, class T, class Compare>
+size_t block_partition(T* array, size_t startIdx, size_t endIdx, const T& pivot, const Compare& comp) {
+
+#if SIMD_PARTITION
+    if constexpr (SimdPartition<T, Compare>::value) {
+        if (endIdx - startIdx >= SIMD_PARTITION_SIZE) {
+            if (simd_level() == SIMD_AVX512) {
+                return block_partition_avx512<OrEqual>(array, startIdx, endIdx, pivot);
+            }
+            if (simd_level() == SIMD_AVX2) {
+                return block_partition_avx2<OrEqual>(array, startIdx, endIdx, pivot);
+            }
+        }
+    }
+#endif
+    return block_partition_scalar<OrEqual>(array, startIdx, endIdx, pivot, comp);
+
+}
+
+//partitions array[startIdx, endIdx) of at least 3 elements into array[startIdx, leftEnd) <= pivot
+//and array[rightStart, endIdx) >= pivot, elements between them are already in place
+template <class T, class Compare>
+void partition(T* array, size_t startIdx, size_t endIdx, size_t& leftEnd, size_t& rightStart, const Compare& comp) {
+
+    choose_pivot(array, startIdx, endIdx, comp);
+    T pivot = array[startIdx];
+
+    size_t divideIdx = block_partition<false>(array, startIdx + 1, endIdx, pivot, comp);
+
+    if (divideIdx > startIdx + 1) {
+        //putting the pivot between the parts
+        array[startIdx] = std::move(array[divideIdx - 1]);
+        array[divideIdx - 1] = std::move(pivot);
+        leftEnd = divideIdx - 1;
+        rightStart = divideIdx;
+    }
+    else {
+        //pivot is the minimum, so all its copies can be put in front and left there
+        leftEnd = startIdx;
+        rightStart = block_partition<true>(array, startIdx, endIdx, pivot, comp);
+    }
+
+}
+
+//quick sort which goes into heap sort after depth bad partitions and into insertion sort on short ranges
+template <class T, class Compare>
+void introsort(T* array, size_t startIdx, size_t endIdx, int depth, const Compare& comp) {
+
+    while (endIdx - startIdx > INSERTION_SORT_SIZE) {
+
+        if (depth == 0) {
+            heap_sort(array, startIdx, endIdx, comp);
+            return;
+        }
+        depth--;
+
+        size_t leftEnd, rightStart;
+        partition(array, startIdx, endIdx, leftEnd, rightStart, comp);
+
+        //recursion goes into the smaller part only, the bigger one is sorted by the loop
+        if (leftEnd - startIdx < endIdx - rightStart) {
+            introsort(array, startIdx, leftEnd, depth, comp);
+            startIdx = rightStart;
+        }
+        else {
+            introsort(array, rightStart, endIdx, depth, comp);
+            endIdx = leftEnd;
+        }
+    }
+
+    insertion_sort(array, startIdx, endIdx, comp);
+
+}
+
+//sequential kernel used by all the realizations
+template <class T, class Compare>
+void sequential_sort(T* array, size_t startIdx, size_t endIdx, const Compare& comp) {
+
+    if (endIdx - startIdx > 1) {
+        int depth = 2 * (int)std::log2((double)(endIdx - startIdx));
+        introsort(array, startIdx, endIdx, depth, comp);
+    }
+
+}
+
+//runs body(0), ..., body(count - 1) as OpenMP tasks and waits for them
+struct OmpFork {
+
+    template <class Body>
+    void operator()(int count, const Body& body) const {
+
+        for (int t = 0; t < count; t++) {
+            #pragma omp task shared(body)
+            body(t);
+        }
+        #pragma omp taskwait
+
+    }
+
+};
+
+//the same with the tasks of a work-stealing pool
+struct StealingFork {
+
+    work_stealing::Pool& pool;
+
+    template <class Body>
+    void operator()(int count, const Body& body) const {
+
+        work_stealing::TaskGroup group(pool);
+        for (int t = 1; t < count; t++) {
+            group.spawn([&body, t]() {
+                body(t);
+            });
+        }
+        body(0);
+        group.wait();
+
+    }
+
+};
+
+//the same as block_partition, but the range is divided into thNum blocks partitioned by separate tasks,
+//after that the elements standing on the wrong side of the resulting border are swapped by tasks too;
+//fork runs the tasks
+template <bool OrEqual, class T, class Compare, class Fork>
+size_t parallel_block_partition(T* array, size_t startIdx, size_t endIdx, const T& pivot, int thNum, const Compare& comp, const Fork& fork) {
+
+    size_t n = endIdx - startIdx;
+    std::vector<size_t> blockStart(thNum + 1);
+    std::vector<size_t> blockMiddle(thNum);
+    for (int t = 0; t <= thNum; t++) {
+        blockStart[t] = startIdx + n * t / thNum;
+    }
+
+    fork(thNum, [&](int t) {
+        blockMiddle[t] = block_partition<OrEqual>(array, blockStart[t], blockStart[t + 1], pivot, comp);
+    });
+
+    size_t divideIdx = startIdx;
+    for (int t = 0; t < thNum; t++) {
+        divideIdx += blockMiddle[t] - blockStart[t];
+    }
+
+    //intervals of big elements before divideIdx and small elements after it,
+    //prefix sums of their lengths let every task find its part of the swaps
+    std::vector<size_t> bigFrom, bigTo, smallFrom, smallTo;
+    std::vector<size_t> bigPrefix(1, 0), smallPrefix(1, 0);
+    for (int t = 0; t < thNum; t++) {
+        size_t from = blockMiddle[t];
+        size_t to = std::min(blockStart[t + 1], divideIdx);
+        if (from < to) {
+            bigFrom.push_back(from);
+            bigTo.push_back(to);
+            bigPrefix.push_back(bigPrefix.back() + to - from);
+        }
+        from = std::max(blockStart[t], divideIdx);
+        to = blockMiddle[t];
+        if (from < to) {
+            smallFrom.push_back(from);
+            smallTo.push_back(to);
+            smallPrefix.push_back(smallPrefix.back() + to - from);
+        }
+    }
+
+    size_t misplaced = bigPrefix.back();
+    fork(thNum, [&](int t) {
+        size_t first = misplaced * t / thNum;
+        size_t last = misplaced * (t + 1) / thNum;
+        if (first < last) {
+            size_t bigIdx = std::upper_bound(bigPrefix.begin(), bigPrefix.end(), first) - bigPrefix.begin() - 1;
+            size_t smallIdx = std::upper_bound(smallPrefix.begin(), smallPrefix.end(), first) - smallPrefix.begin() - 1;
+            size_t bigPos = bigFrom[bigIdx] + (first - bigPrefix[bigIdx]);
+            size_t smallPos = smallFrom[smallIdx] + (first - smallPrefix[smallIdx]);
+
+            for (size_t i = first; i < last; i++) {
+                if (bigPos == bigTo[bigIdx]) {
+                    bigIdx++;
+                    bigPos = bigFrom[bigIdx];
+                }
+                if (smallPos == smallTo[smallIdx]) {
+                    smallIdx++;
+                    smallPos = smallFrom[smallIdx];
+                }
+                std::swap(array[bigPos], array[smallPos]);
+                bigPos++;
+                smallPos++;
+            }
+        }
+    });
+
+    return divideIdx;
+
+}
+
+//partitions array[startIdx, endIdx) with thNum threads like partition does
+template <class T, class Compare, class Fork = OmpFork>
+void parallel_partition(T* array, size_t startIdx, size_t endIdx, int thNum, size_t& leftEnd, size_t& rightStart, const Compare& comp, const Fork& fork = Fork()) {
+
+    choose_pivot(array, startIdx, endIdx, comp);
+    T pivot = array[startIdx];
+
+    size_t divideIdx = parallel_block_partition<false>(array, startIdx, endIdx, pivot, thNum, comp, fork);
+
+    if (divideIdx > startIdx) {
+        leftEnd = divideIdx;
+        rightStart = divideIdx;
+    }
+    else {
+        //pivot is the minimum, so all its copies can be put in front and left there
+        leftEnd = startIdx;
+        rightStart = parallel_block_partition<true>(array, startIdx, endIdx, pivot, thNum, comp, fork);
+    }
+
+}
+
+//called by one thread of a parallel region of thNum threads, the parts and the blocks of a parallel partition
+//are tasks of that team, so every level of the recursion is shared by all the threads
+template <class T, class Compare>
+void sort_with_tasks(T* array, size_t startIdx, size_t endIdx, int thNum, const Compare& comp) {
+
+    //a way to reduce execution time
+    if (endIdx - startIdx < TASK_SIZE) {
+        sequential_sort(array, startIdx, endIdx, comp);
+    }
+    else {
+        size_t leftEnd, rightStart;
+
+        if (thNum > 1 and endIdx - startIdx >= PARALLEL_PARTITION_SIZE) {
+            //the range is too long to be partitioned by one thread
+            parallel_partition(array, startIdx, endIdx, thNum, leftEnd, rightStart, comp);
+        }
+        else {
+            partition(array, startIdx, endIdx, leftEnd, rightStart, comp);
+        }
+
+        #pragma omp task
+        sort_with_tasks(array, startIdx, leftEnd, thNum, comp);
+        #pragma omp task
+        sort_with_tasks(array, rightStart, endIdx, thNum, comp);
+        #pragma omp taskwait
+    }
+
+}
+
+//sections are bound to their own team, so every level opens a nested team of two threads for the two parts
+//and the thNum threads of the range are divided between them in proportion to the sizes of the parts,
+//a range left with one thread is sorted sequentially; nesting has to be active for thNum levels
+template <class T, class Compare>
+void sort_with_sections(T* array, size_t startIdx, size_t endIdx, int thNum, const Compare& comp) {
+
+    if (thNum == 1 or endIdx - startIdx < TASK_SIZE) {
+        sequential_sort(array, startIdx, endIdx, comp);
+    }
+    else {
+        size_t leftEnd, rightStart;
+
+        if (endIdx - startIdx >= PARALLEL_PARTITION_SIZE) {
+            //the range is too long to be partitioned by one thread, the blocks are tasks of a team of its threads
+            #pragma omp parallel num_threads(thNum)
+            {
+                #pragma omp single
+                parallel_partition(array, startIdx, endIdx, thNum, leftEnd, rightStart, comp);
+            }
+        }
+        else {
+            partition(array, startIdx, endIdx, leftEnd, rightStart, comp);
+        }
+
+        size_t leftSize = leftEnd - startIdx;
+        size_t sortedSize = leftSize + endIdx - rightStart;
+        int leftThreads = sortedSize > 0 ? (int)((leftSize * thNum + sortedSize / 2) / sortedSize) : 1;
+        leftThreads = std::min(std::max(leftThreads, 1), thNum - 1);
+
+        #pragma omp parallel num_threads(2)
+        {
+            #pragma omp sections
+            {
+                #pragma omp section
+                sort_with_sections(array, startIdx, leftEnd, leftThreads, comp);
+                #pragma omp section
+                sort_with_sections(array, rightStart, endIdx, thNum - leftThreads, comp);
+            }
+        }
+    }
+
+}
+
+//multi-select: partitions like sort_with_tasks, but goes only into the parts which contain some of
+//ranks[0, rankCount) (sorted), so that array[r] for every such rank r gets its place of the sorted order;
+//called by one thread of a parallel region, the parts with ranks on both sides are split between tasks
+template <class T, class Compare>
+void select_with_tasks(T* array, size_t startIdx, size_t endIdx, const size_t* ranks, size_t rankCount, int depth, int thNum, const Compare& comp) {
+
+    while (rankCount > 0 and endIdx - startIdx > INSERTION_SORT_SIZE) {
+
+        if (depth == 0) {
+            heap_sort(array, startIdx, endIdx, comp);
+            return;
+        }
+        depth--;
+
+        size_t leftEnd, rightStart;
+
+        if (thNum > 1 and endIdx - startIdx >= PARALLEL_PARTITION_SIZE) {
+            //the range is too long to be partitioned by one thread
+            parallel_partition(array, startIdx, endIdx, thNum, leftEnd, rightStart, comp);
+        }
+        else {
+            partition(array, startIdx, endIdx, leftEnd, rightStart, comp);
+        }
+
+        //ranks between leftEnd and rightStart are already in place
+        size_t leftCount = std::lower_bound(ranks, ranks + rankCount, leftEnd) - ranks;
+        const size_t* rightRanks = std::lower_bound(ranks + leftCount, ranks + rankCount, rightStart);
+        size_t rightCount = ranks + rankCount - rightRanks;
+
+        if (leftCount > 0 and rightCount > 0) {
+            if (leftEnd - startIdx >= TASK_SIZE) {
+                #pragma omp task
+                select_with_tasks(array, startIdx, leftEnd, ranks, leftCount, depth, thNum, comp);
+            }
+            else {
+                select_with_tasks(array, startIdx, leftEnd, ranks, leftCount, depth, thNum, comp);
+            }
+        }
+
+        if (rightCount > 0) {
+            startIdx = rightStart;
+            ranks = rightRanks;
+            rankCount = rightCount;
+        }
+        else {
+            endIdx = leftEnd;
+            rankCount = leftCount;
+        }
+    }
+
+    if (rankCount > 0) {
+        insertion_sort(array, startIdx, endIdx, comp);
+    }
+
+}
+
+//the same recursion as sort_with_tasks on the work-stealing pool: the smaller part is spawned
+//and the bigger one is sorted by the loop, so idle workers steal the biggest parts first
+template <class T, class Compare>
+void sort_with_stealing(work_stealing::Pool& pool, T* array, size_t startIdx, size_t endIdx, const Compare& comp) {
+
+    work_stealing::TaskGroup group(pool);
+
+    while (endIdx - startIdx >= TASK_SIZE) {
+        size_t leftEnd, rightStart;
+
+        if (pool.size() > 1 and endIdx - startIdx >= PARALLEL_PARTITION_SIZE) {
+            //the range is too long to be partitioned by one thread
+            parallel_partition(array, startIdx, endIdx, pool.size(), leftEnd, rightStart, comp, StealingFork{ pool });
+        }
+        else {
+            partition(array, startIdx, endIdx, leftEnd, rightStart, comp);
+        }
+
+        if (leftEnd - startIdx < endIdx - rightStart) {
+            group.spawn([&pool, array, startIdx, leftEnd, &comp]() {
+                sort_with_stealing(pool, array, startIdx, leftEnd, comp);
+            });
+            startIdx = rightStart;
+        }
+        else {
+            group.spawn([&pool, array, rightStart, endIdx, &comp]() {
+                sort_with_stealing(pool, array, rightStart, endIdx, comp);
+            });
+            endIdx = leftEnd;
+        }
+    }
+
+    sequential_sort(array, startIdx, endIdx, comp);
+    group.wait();
+
+}
+
+//turns counts[c * buckets + b] (elements of chunk c in bucket b) into the positions where chunk c
+//writes bucket b and fills bucketStart, it is a parallel prefix sum called by every thread of a region
+inline void chunk_offsets(std::vector<size_t>& counts, std::vector<size_t>& bucketStart, int chunks, int buckets) {
+
+    #pragma omp for
+    for (int b = 0; b < buckets; b++) {
+        size_t size = 0;
+        for (int c = 0; c < chunks; c++) {
+            size += counts[(size_t)c * buckets + b];
+        }
+        bucketStart[b + 1] = size;
+    }
+    #pragma omp single
+    for (int b = 0; b < buckets; b++) {
+        bucketStart[b + 1] += bucketStart[b];
+    }
+    #pragma omp for
+    for (int b = 0; b < buckets; b++) {
+        size_t offset = bucketStart[b];
+        for (int c = 0; c < chunks; c++) {
+            size_t count = counts[(size_t)c * buckets + b];
+            counts[(size_t)c * buckets + b] = offset;
+            offset += count;
+        }
+    }
+
+}
+
+template <class T, class Compare>
+void sort_with_samples(T* array, size_t n, int thNum, const Compare& comp) {
+
+    using Key = typename KeyOf<T>::type;
+
+    //choosing thNum - 1 splitters from a sorted random sample
+    int sampleSize = thNum * SAMPLE_OVERSAMPLING;
+    std::vector<Key> sample(sampleSize);
+    std::mt19937 generator((unsigned int)n);
+    std::uniform_int_distribution<size_t> position(0, n - 1);
+    for (int i = 0; i < sampleSize; i++) {
+        sample[i] = KeyOf<T>::get(array[position(generator)]);
+    }
+    sequential_sort(sample.data(), 0, sampleSize, comp);
+
+    std::vector<Key> splitters(thNum - 1);
+    for (int i = 0; i < thNum - 1; i++) {
+        splitters[i] = sample[(i + 1) * SAMPLE_OVERSAMPLING];
+    }
+
+    //bucket 2 * i holds elements between splitters i - 1 and i, bucket 2 * i + 1 holds copies of splitter i,
+    //so a key repeated over many splitters gets its own bucket which needs no sorting
+    int buckets = 2 * thNum - 1;
+    auto bucket_of = [&splitters, &comp](const Key& key) {
+        int i = std::lower_bound(splitters.begin(), splitters.end(), key, comp) - splitters.begin();
+        if (i < (int)splitters.size() and !comp(key, splitters[i])) {
+            return 2 * i + 1;
+        }
+        return 2 * i;
+    };
+
+    T* buffer = new (std::nothrow) T[n];
+    unsigned short* bucketIdx = new (std::nothrow) unsigned short[n];
+    if (buffer == nullptr or bucketIdx == nullptr) {
+        std::cerr << "Memory can not be allocated";
+        exit(1);
+    }
+
+    //counts[c * buckets + b] is the number of elements of chunk c in bucket b, later - where chunk c writes them
+    std::vector<size_t> counts((size_t)thNum * buckets, 0);
+    std::vector<size_t> bucketStart(buckets + 1, 0);
+
+    #pragma omp parallel num_threads(thNum)
+    {
+        #pragma omp for schedule(static, 1)
+        for (int c = 0; c < thNum; c++) {
+            size_t* count = &counts[(size_t)c * buckets];
+            for (size_t i = n * c / thNum; i < n * (c + 1) / thNum; i++) {
+                bucketIdx[i] = (unsigned short)bucket_of(KeyOf<T>::get(array[i]));
+                count[bucketIdx[i]]++;
+            }
+        }
+
+        chunk_offsets(counts, bucketStart, thNum, buckets);
+
+        #pragma omp for schedule(static, 1)
+        for (int c = 0; c < thNum; c++) {
+            size_t* offset = &counts[(size_t)c * buckets];
+            for (size_t i = n * c / thNum; i < n * (c + 1) / thNum; i++) {
+                buffer[offset[bucketIdx[i]]++] = std::move(array[i]);
+            }
+        }
+
+        //every bucket is sorted on its own and copied back while it is still in cache
+        #pragma omp for schedule(dynamic, 1)
+        for (int b = 0; b < buckets; b++) {
+            if (b % 2 == 0) {
+                sequential_sort(buffer, bucketStart[b], bucketStart[b + 1], comp);
+            }
+            std::move(buffer + bucketStart[b], buffer + bucketStart[b + 1], array + bucketStart[b]);
+        }
+    }
+
+    delete[] buffer;
+    delete[] bucketIdx;
+
+}
+
+//key transformations which make the unsigned order of the bits the same as the order of the keys
+template <class Key> struct RadixKey;
+
+template <> struct RadixKey<std::int32_t> {
+    using Bits = std::uint32_t;
+    static Bits bits(std::int32_t key) { return (Bits)key ^ 0x80000000u; }
+};
+
+template <> struct RadixKey<std::uint32_t> {
+    using Bits = std::uint32_t;
+    static Bits bits(std::uint32_t key) { return key; }
+};
+
+template <> struct RadixKey<std::int64_t> {
+    using Bits = std::uint64_t;
+    static Bits bits(std::int64_t key) { return (Bits)key ^ 0x8000000000000000ull; }
+};
+
+template <> struct RadixKey<std::uint64_t> {
+    using Bits = std::uint64_t;
+    static Bits bits(std::uint64_t key) { return key; }
+};
+
+//negative floating point numbers have all the bits flipped, positive ones - only the sign
+template <> struct RadixKey<float> {
+    using Bits = std::uint32_t;
+    static Bits bits(float key) {
+        Bits b;
+        std::memcpy(&b, &key, sizeof(b));
+        return b ^ ((Bits)-(std::int32_t)(b >> 31) | 0x80000000u);
+    }
+};
+
+template <> struct RadixKey<double> {
+    using Bits = std::uint64_t;
+    static Bits bits(double key) {
+        Bits b;
+        std::memcpy(&b, &key, sizeof(b));
+        return b ^ ((Bits)-(std::int64_t)(b >> 63) | 0x8000000000000000ull);
+    }
+};
+
+template <class T>
+inline int radix_digit(const T& element, int shift) {
+    using Key = typename KeyOf<T>::type;
+    return (int)((RadixKey<Key>::bits(KeyOf<T>::get(element)) >> shift) & (RADIX_BUCKETS - 1));
+}
+
+template <class T>
+void sort_with_radix(T* array, size_t n, int thNum) {
+
+    using Bits = typename RadixKey<typename KeyOf<T>::type>::Bits;
+    const size_t line = std::max<size_t>(RADIX_BUFFER_BYTES / sizeof(T), 4);
+
+    T* buffer = new (std::nothrow) T[n];
+    if (buffer == nullptr) {
+        std::cerr << "Memory can not be allocated";
+        exit(1);
+    }
+
+    std::vector<size_t> counts((size_t)thNum * RADIX_BUCKETS);
+    std::vector<size_t> bucketStart(RADIX_BUCKETS + 1, 0);
+    T* from = array;
+    T* to = buffer;
+
+    for (int shift = 0; shift < (int)sizeof(Bits) * 8; shift += RADIX_BITS) {
+
+        bool sameDigit = false;
+
+        #pragma omp parallel num_threads(thNum)
+        {
+            #pragma omp for schedule(static, 1)
+            for (int c = 0; c < thNum; c++) {
+                size_t* count = &counts[(size_t)c * RADIX_BUCKETS];
+                std::fill(count, count + RADIX_BUCKETS, 0);
+                for (size_t i = n * c / thNum; i < n * (c + 1) / thNum; i++) {
+                    count[radix_digit(from[i], shift)]++;
+                }
+            }
+
+            chunk_offsets(counts, bucketStart, thNum, RADIX_BUCKETS);
+
+            //the pass changes nothing when all the elements have the same digit
+            #pragma omp single
+            for (int b = 0; b < RADIX_BUCKETS; b++) {
+                if (bucketStart[b + 1] - bucketStart[b] == n) {
+                    sameDigit = true;
+                }
+            }
+
+            //elements are gathered into a cache line per digit and written out by whole lines,
+            //so the scatter does not touch 256 different pages and lines for every few elements
+            if (!sameDigit) {
+                std::vector<T> lines(RADIX_BUCKETS * line);
+                size_t filled[RADIX_BUCKETS];
+
+                #pragma omp for schedule(static, 1)
+                for (int c = 0; c < thNum; c++) {
+                    size_t* offset = &counts[(size_t)c * RADIX_BUCKETS];
+                    std::fill(filled, filled + RADIX_BUCKETS, 0);
+                    for (size_t i = n * c / thNum; i < n * (c + 1) / thNum; i++) {
+                        int digit = radix_digit(from[i], shift);
+                        T* digitLine = &lines[digit * line];
+                        digitLine[filled[digit]++] = from[i];
+                        if (filled[digit] == line) {
+                            std::copy(digitLine, digitLine + line, to + offset[digit]);
+                            offset[digit] += line;
+                            filled[digit] = 0;
+                        }
+                    }
+                    for (int digit = 0; digit < RADIX_BUCKETS; digit++) {
+                        T* digitLine = &lines[digit * line];
+                        std::copy(digitLine, digitLine + filled[digit], to + offset[digit]);
+                    }
+                }
+            }
+        }
+
+        if (!sameDigit) {
+            std::swap(from, to);
+        }
+    }
+
+    if (from != array) {
+        #pragma omp parallel for num_threads(thNum)
+        for (long long i = 0; i < (long long)n; i++) {
+            array[i] = from[i];
+        }
+    }
+
+    delete[] buffer;
+
+}
+
+//co-ranking: how many of the first k elements of the stable merge of a[0, na) and b[0, nb) come from a,
+//the binary search looks for the split where a[i - 1] goes before b[k - i] and b[k - i - 1] before a[i]
+template <class T, class Less>
+size_t co_rank(size_t k, const T* a, size_t na, const T* b, size_t nb, const Less& less) {
+
+    size_t low = k > nb ? k - nb : 0;
+    size_t high = std::min(k, na);
+    while (low < high) {
+        size_t i = (low + high) / 2;
+        //on equal keys the element of a goes first
+        if (!less(b[k - i - 1], a[i])) {
+            low = i + 1;
+        }
+        else {
+            high = i;
+        }
+    }
+    return low;
+
+}
+
+//stable merge of [a, aEnd) and [b, bEnd) into output without branches on the comparison:
+//both pointers move by a flag, so random keys do not cost a misprediction per element
+template <class T, class Less>
+void branchless_merge(const T* a, const T* aEnd, const T* b, const T* bEnd, T* output, const Less& less) {
+
+    while (a < aEnd and b < bEnd) {
+        bool fromB = less(*b, *a);
+        *output++ = fromB ? *b : *a;
+        b += fromB;
+        a += !fromB;
+    }
+    output = std::copy(a, aEnd, output);
+    std::copy(b, bEnd, output);
+
+}
+
+//merges the neighbouring pairs of the sorted runs src[bounds[r], bounds[r + 1]) into the same places of dst,
+//every merge is cut by co-ranking into pieces merged in parallel; bounds become the runs of dst
+template <class T, class Compare>
+void merge_pairs(const T* src, T* dst, std::vector<size_t>& bounds, int thNum, const Compare& comp) {
+
+    auto less = [&comp](const T& a, const T& b) {
+        return element_less(comp, a, b);
+    };
+
+    struct Piece {
+        size_t start, middle, end;
+        //part of the output relative to start
+        size_t from, to;
+    };
+
+    size_t runs = bounds.size() - 1;
+    std::vector<Piece> pieces;
+    std::vector<size_t> merged(1, bounds[0]);
+    for (size_t r = 0; r < runs; r += 2) {
+        size_t start = bounds[r];
+        size_t middle = bounds[std::min(r + 1, runs)];
+        size_t end = bounds[std::min(r + 2, runs)];
+        size_t length = end - start;
+        size_t count = std::max<size_t>(length / MERGE_PIECE_SIZE, 1);
+        for (size_t p = 0; p < count; p++) {
+            pieces.push_back({ start, middle, end, length * p / count, length * (p + 1) / count });
+        }
+        merged.push_back(end);
+    }
+
+    #pragma omp parallel for num_threads(thNum) schedule(dynamic, 1) if(thNum > 1)
+    for (long long p = 0; p < (long long)pieces.size(); p++) {
+        const Piece& piece = pieces[p];
+        const T* a = src + piece.start;
+        const T* b = src + piece.middle;
+        size_t na = piece.middle - piece.start;
+        size_t nb = piece.end - piece.middle;
+        size_t aFrom = co_rank(piece.from, a, na, b, nb, less);
+        size_t aTo = co_rank(piece.to, a, na, b, nb, less);
+        branchless_merge(a + aFrom, a + aTo, b + (piece.from - aFrom), b + (piece.to - aTo), dst + piece.start + piece.from, less);
+    }
+
+    bounds.swap(merged);
+
+}
+
+//merges the sorted runs array[bounds[r], bounds[r + 1]) by a balanced tree of parallel merges,
+//the levels go back and forth between array and buffer
+template <class T, class Compare>
+void merge_runs(T* array, T* buffer, std::vector<size_t> bounds, int thNum, const Compare& comp) {
+
+    T* from = array;
+    T* to = buffer;
+    while (bounds.size() > 2) {
+        merge_pairs(from, to, bounds, thNum, comp);
+        std::swap(from, to);
+    }
+
+    if (from != array) {
+        size_t startIdx = bounds.front();
+        size_t endIdx = bounds.back();
+        #pragma omp parallel for num_threads(thNum) if(thNum > 1)
+        for (long long i = (long long)startIdx; i < (long long)endIdx; i++) {
+            array[i] = from[i];
+        }
+    }
+
+}
+
+//stable: blocks are sorted in cache by insertion sort of short pieces and merges,
+//then the blocks are merged by all threads; the merges go back and forth between array and one buffer
+template <class T, class Compare>
+void sort_with_merges(T* array, size_t n, int thNum, const Compare& comp) {
+
+    T* buffer = new (std::nothrow) T[n];
+    if (buffer == nullptr) {
+        std::cerr << "Memory can not be allocated";
+        exit(1);
+    }
+
+    size_t blockSize = std::max<size_t>(MERGE_SORT_BLOCK_BYTES / sizeof(T), INSERTION_SORT_SIZE);
+    size_t blocks = (n + blockSize - 1) / blockSize;
+
+    #pragma omp parallel for num_threads(thNum) schedule(dynamic, 1)
+    for (long long b = 0; b < (long long)blocks; b++) {
+        size_t blockStart = b * blockSize;
+        size_t blockEnd = std::min(n, blockStart + blockSize);
+        std::vector<size_t> pieces;
+        for (size_t i = blockStart; i < blockEnd; i += INSERTION_SORT_SIZE) {
+            pieces.push_back(i);
+            insertion_sort(array, i, std::min(blockEnd, i + INSERTION_SORT_SIZE), comp);
+        }
+        pieces.push_back(blockEnd);
+        merge_runs(array, buffer, pieces, 1, comp);
+    }
+
+    std::vector<size_t> bounds;
+    for (size_t b = 0; b < blocks; b++) {
+        bounds.push_back(b * blockSize);
+    }
+    bounds.push_back(n);
+    merge_runs(array, buffer, bounds, thNum, comp);
+
+    delete[] buffer;
+
+}
+
+template <class T, class Compare>
+void sort_with_runs(T* array, size_t n, int thNum, const Compare& comp) {
+
+    auto less = [&comp](const T& a, const T& b) {
+        return element_less(comp, a, b);
+    };
+
+    work_stealing::Pool& pool = work_stealing::Pool::shared(thNum);
+
+    //random data has no long runs at all, a few probes spare the scan for it
+    bool runsFound = false;
+    for (int p = 0; p < RUN_PROBES and !runsFound; p++) {
+        size_t i = n * p / RUN_PROBES;
+        size_t limit = std::min(n, i + MIN_RUN_SIZE);
+        size_t ascending = i + 1;
+        while (ascending < limit and !less(array[ascending], array[ascending - 1])) {
+            ascending++;
+        }
+        size_t descending = i + 1;
+        while (descending < limit and less(array[descending], array[descending - 1])) {
+            descending++;
+        }
+        runsFound = (ascending - i == MIN_RUN_SIZE or descending - i == MIN_RUN_SIZE);
+    }
+    if (!runsFound) {
+        pool.run([&]() {
+            sort_with_stealing(pool, array, 0, n, comp);
+        });
+        return;
+    }
+
+    //every thread cuts its chunk into natural runs of at least MIN_RUN_SIZE elements, descending ones are reversed,
+    //and stretches of shorter runs between them, which are left to be sorted
+    std::vector<std::vector<size_t>> chunkEnds(thNum);
+    std::vector<std::vector<char>> chunkSorted(thNum);
+    #pragma omp parallel for num_threads(thNum) schedule(static, 1)
+    for (int t = 0; t < thNum; t++) {
+        std::vector<size_t>& ends = chunkEnds[t];
+        std::vector<char>& sorted = chunkSorted[t];
+        size_t chunkEnd = n * (t + 1) / thNum;
+        size_t i = n * t / thNum;
+        while (i < chunkEnd) {
+            size_t j = i + 1;
+            bool descending = j < chunkEnd and less(array[j], array[i]);
+            if (descending) {
+                //strictly descending, so reversing keeps equal elements in order
+                while (j < chunkEnd and less(array[j], array[j - 1])) {
+                    j++;
+                }
+            }
+            else {
+                while (j < chunkEnd and !less(array[j], array[j - 1])) {
+                    j++;
+                }
+            }
+
+            if (j - i >= MIN_RUN_SIZE) {
+                if (descending) {
+                    std::reverse(array + i, array + j);
+                }
+                ends.push_back(j);
+                sorted.push_back(1);
+            }
+            else if (!sorted.empty() and !sorted.back()) {
+                ends.back() = j;
+            }
+            else {
+                ends.push_back(j);
+                sorted.push_back(0);
+            }
+            i = j;
+        }
+    }
+
+    //neighbouring runs which continue each other become one, and so do neighbouring stretches,
+    //it happens at chunk borders
+    std::vector<size_t> bounds(1, 0);
+    std::vector<char> boundSorted;
+    for (int t = 0; t < thNum; t++) {
+        for (size_t i = 0; i < chunkEnds[t].size(); i++) {
+            size_t start = bounds.back();
+            bool sorted = chunkSorted[t][i];
+            if (!boundSorted.empty() and boundSorted.back() == sorted and (!sorted or !less(array[start], array[start - 1]))) {
+                bounds.back() = chunkEnds[t][i];
+            }
+            else {
+                bounds.push_back(chunkEnds[t][i]);
+                boundSorted.push_back(sorted);
+            }
+        }
+    }
+
+    if (bounds.size() <= 2 and (boundSorted.empty() or boundSorted[0])) {
+        //already sorted
+        return;
+    }
+
+    std::vector<size_t> unsortedStart, unsortedEnd;
+    for (size_t r = 0; r < boundSorted.size(); r++) {
+        if (!boundSorted[r]) {
+            unsortedStart.push_back(bounds[r]);
+            unsortedEnd.push_back(bounds[r + 1]);
+        }
+    }
+
+    //long ranges get all the threads of the work-stealing pool, the rest are sorted one per thread
+    for (size_t u = 0; u < unsortedStart.size(); u++) {
+        if (unsortedEnd[u] - unsortedStart[u] >= n / thNum) {
+            pool.run([&]() {
+                sort_with_stealing(pool, array, unsortedStart[u], unsortedEnd[u], comp);
+            });
+        }
+    }
+    #pragma omp parallel for num_threads(thNum) schedule(dynamic, 1)
+    for (long long u = 0; u < (long long)unsortedStart.size(); u++) {
+        if (unsortedEnd[u] - unsortedStart[u] < n / thNum) {
+            sequential_sort(array, unsortedStart[u], unsortedEnd[u], comp);
+        }
+    }
+
+    if (bounds.size() > 2) {
+        T* buffer = new (std::nothrow) T[n];
+        if (buffer == nullptr) {
+            std::cerr << "Memory can not be allocated";
+            exit(1);
+        }
+        merge_runs(array, buffer, bounds, thNum, comp);
+        delete[] buffer;
+    }
+
+}
+
+//realizations: Compare compares keys, by default in ascending order
+
+template <class T, class Compare = std::less<typename KeyOf<T>::type>>
+void quick_sort(T* array, size_t n, Compare comp = Compare()) {
+    sequential_sort(array, 0, n, comp);
+}
+
+template <class T, class Compare = std::less<typename KeyOf<T>::type>>
+void quick_sort_with_sections(T* array, size_t n, int thNum, Compare comp = Compare()) {
+
+    //every level of the recursion takes at least one thread, and the partition adds one more level
+    int maxActiveLevels = omp_get_max_active_levels();
+    omp_set_max_active_levels(std::max(maxActiveLevels, thNum + 1));
+    sort_with_sections(array, 0, n, thNum, comp);
+    omp_set_max_active_levels(maxActiveLevels);
+
+}
+
+template <class T, class Compare = std::less<typename KeyOf<T>::type>>
+void quick_sort_with_tasks(T* array, size_t n, int thNum, Compare comp = Compare()) {
+
+    #pragma omp parallel num_threads(thNum)
+    {
+        #pragma omp single
+        sort_with_tasks(array, 0, n, thNum, comp);
+    }
+
+}
+
+//quick sort on the built-in work-stealing pool instead of OpenMP
+template <class T, class Compare = std::less<typename KeyOf<T>::type>>
+void quick_sort_with_stealing(T* array, size_t n, int thNum, Compare comp = Compare()) {
+
+    work_stealing::Pool& pool = work_stealing::Pool::shared(thNum);
+    pool.run([&]() {
+        sort_with_stealing(pool, array, 0, n, comp);
+    });
+
+}
+
+//ascending order of integer or floating point keys only
+template <class T>
+void radix_sort(T* array, size_t n, int thNum) {
+    sort_with_radix(array, n, thNum);
+}
+
+//stable merge sort: elements with equal keys keep their order
+template <class T, class Compare = std::less<typename KeyOf<T>::type>>
+void merge_sort(T* array, size_t n, int thNum, Compare comp = Compare()) {
+    sort_with_merges(array, n, thNum, comp);
+}
+
+//quick sort which keeps the order already present: natural runs are merged, short ones are sorted first
+template <class T, class Compare = std::less<typename KeyOf<T>::type>>
+void adaptive_sort(T* array, size_t n, int thNum, Compare comp = Compare()) {
+    sort_with_runs(array, n, thNum, comp);
+}
+
+template <class T, class Compare = std::less<typename KeyOf<T>::type>>
+void sample_sort(T* array, size_t n, int thNum, Compare comp = Compare()) {
+
+    //too small arrays do not give enough elements for the sample
+    if (thNum == 1 or n < (size_t)thNum * SAMPLE_OVERSAMPLING * 4) {
+        sequential_sort(array, 0, n, comp);
+    }
+    else {
+        sort_with_samples(array, n, thNum, comp);
+    }
+
+}
+
+//selection: O(n) expected work instead of sorting everything
+
+//array[r] becomes the element of rank r in the sorted order for every r of ranks, elements before it are not greater
+//and elements after it are not less
+template <class T, class Compare = std::less<typename KeyOf<T>::type>>
+void multi_select(T* array, size_t n, std::vector<size_t> ranks, int thNum, Compare comp = Compare()) {
+
+    std::sort(ranks.begin(), ranks.end());
+    ranks.erase(std::unique(ranks.begin(), ranks.end()), ranks.end());
+    ranks.erase(std::lower_bound(ranks.begin(), ranks.end(), n), ranks.end());
+    if (ranks.empty()) {
+        return;
+    }
+
+    int depth = 2 * (int)std::log2((double)n);
+    #pragma omp parallel num_threads(thNum)
+    {
+        #pragma omp single
+        select_with_tasks(array, 0, n, ranks.data(), ranks.size(), depth, thNum, comp);
+    }
+
+}
+
+//the k smallest elements sorted in array[0, k)
+template <class T, class Compare = std::less<typename KeyOf<T>::type>>
+void top_k(T* array, size_t n, size_t k, int thNum, Compare comp = Compare()) {
+
+    k = std::min(k, n);
+    if (k == 0) {
+        return;
+    }
+    if (k < n) {
+        //array[k - 1] is already in place
+        multi_select(array, n, std::vector<size_t>(1, k - 1), thNum, comp);
+        k--;
+    }
+    quick_sort_with_tasks(array, k, thNum, comp);
+
+}
+
+}
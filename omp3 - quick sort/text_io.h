@@ -0,0 +1,198 @@
+#pragma once
+
+//text input and output of the sort tool: the file is read at once and split at whitespace between threads,
+//numbers are parsed with from_chars and formatted with to_chars into per-thread buffers written in order
+
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <omp.h>
+
+//elements formatted by one thread before the buffers are written
+#define FORMAT_BLOCK 65536
+//largest block of bytes read at once when the file does not fit in memory, a smaller memory budget gets a smaller one
+#define READ_BLOCK (1 << 24)
+//smallest block of bytes read at once, a number and its separator always fit in it
+#define MIN_READ_BLOCK 4096
+//"-2147483648 "
+#define MAX_NUMBER_CHARS 12
+
+namespace text_io {
+
+inline bool is_space(char c) {
+    return c == ' ' or c == '\n' or c == '\r' or c == '\t';
+}
+
+//parses the number at text, returns the position after it or nullptr if there is no number
+inline const char* parse_number(const char* text, const char* end, int& value) {
+
+    if (text < end and *text == '+') {
+        text++;
+    }
+    std::from_chars_result result = std::from_chars(text, end, value);
+    if (result.ec != std::errc()) {
+        return nullptr;
+    }
+    return result.ptr;
+
+}
+
+//parses the numbers of [begin, end) into array with thNum threads and returns how many there were,
+//only the first n are stored; the text is split at whitespace, every thread counts the numbers of its part
+//and then parses them to their place
+inline size_t parse_numbers(const char* begin, const char* end, int* array, size_t n, int thNum) {
+
+    std::vector<const char*> bounds(thNum + 1);
+    std::vector<size_t> offset(thNum + 1, 0);
+    size_t length = end - begin;
+
+    bounds[0] = begin;
+    bounds[thNum] = end;
+    for (int t = 1; t < thNum; t++) {
+        const char* bound = std::max(begin + length * t / thNum, bounds[t - 1]);
+        while (bound < end and !is_space(*bound)) {
+            bound++;
+        }
+        bounds[t] = bound;
+    }
+
+    #pragma omp parallel for num_threads(thNum)
+    for (int t = 0; t < thNum; t++) {
+        size_t count = 0;
+        bool inside = false;
+        for (const char* p = bounds[t]; p < bounds[t + 1]; p++) {
+            bool space = is_space(*p);
+            if (!space and !inside) {
+                count++;
+            }
+            inside = !space;
+        }
+        offset[t + 1] = count;
+    }
+    for (int t = 0; t < thNum; t++) {
+        offset[t + 1] += offset[t];
+    }
+
+    bool valid = true;
+    #pragma omp parallel for num_threads(thNum) reduction(&&:valid)
+    for (int t = 0; t < thNum; t++) {
+        const char* p = bounds[t];
+        const char* partEnd = bounds[t + 1];
+        for (size_t i = offset[t]; i < offset[t + 1] and i < n; i++) {
+            while (is_space(*p)) {
+                p++;
+            }
+            int value;
+            //a number has to end at whitespace, so "12abc" is not taken as 12 when it is the last one of a part
+            p = parse_number(p, partEnd, value);
+            if (p == nullptr or (p < partEnd and !is_space(*p))) {
+                valid = false;
+                break;
+            }
+            array[i] = value;
+        }
+    }
+
+    if (!valid) {
+        std::cerr << "Wrong number format";
+        exit(1);
+    }
+
+    return offset[thNum];
+
+}
+
+//reads numbers of a stream by blocks of blockSize bytes, for files that do not fit in memory
+class NumberReader {
+
+public:
+
+    explicit NumberReader(std::istream& input, size_t blockSize = READ_BLOCK)
+        : input(input), buffer(std::max<size_t>(blockSize, MIN_READ_BLOCK)) {
+        pos = limit = end = buffer.data();
+    }
+
+    //reads at most count numbers, returns how many were read
+    size_t read(int* array, size_t count) {
+
+        size_t done = 0;
+        while (done < count) {
+            while (pos < limit and is_space(*pos)) {
+                pos++;
+            }
+            if (pos == limit) {
+                if (!refill()) {
+                    break;
+                }
+                continue;
+            }
+            pos = parse_number(pos, limit, array[done]);
+            if (pos == nullptr) {
+                std::cerr << "Wrong number format";
+                exit(1);
+            }
+            done++;
+        }
+        return done;
+
+    }
+
+private:
+
+    std::istream& input;
+    std::vector<char> buffer;
+    const char* pos;
+    //numbers before limit are whole, the one after it may continue in the next block
+    const char* limit;
+    const char* end;
+
+    bool refill() {
+
+        size_t tail = end - pos;
+        memmove(buffer.data(), pos, tail);
+        input.read(buffer.data() + tail, buffer.size() - tail);
+        pos = buffer.data();
+        end = pos + tail + input.gcount();
+
+        limit = end;
+        if (input) {
+            while (limit > pos and !is_space(limit[-1])) {
+                limit--;
+            }
+        }
+        return pos < limit;
+
+    }
+
+};
+
+//writes array separated by spaces, every thread formats its part of a block
+inline void write_numbers(std::ostream& output, const int* array, size_t n, int thNum) {
+
+    std::vector<std::vector<char>> buffers(thNum, std::vector<char>((size_t)FORMAT_BLOCK * MAX_NUMBER_CHARS));
+    std::vector<size_t> lengths(thNum);
+
+    for (size_t start = 0; start < n; start += (size_t)thNum * FORMAT_BLOCK) {
+        #pragma omp parallel for num_threads(thNum)
+        for (int t = 0; t < thNum; t++) {
+            size_t from = std::min(n, start + (size_t)t * FORMAT_BLOCK);
+            size_t to = std::min(n, from + FORMAT_BLOCK);
+            char* p = buffers[t].data();
+            char* bufferEnd = p + buffers[t].size();
+            for (size_t i = from; i < to; i++) {
+                p = std::to_chars(p, bufferEnd, array[i]).ptr;
+                *p++ = ' ';
+            }
+            lengths[t] = p - buffers[t].data();
+        }
+        for (int t = 0; t < thNum; t++) {
+            output.write(buffers[t].data(), lengths[t]);
+        }
+    }
+
+}
+
+}